@@ -0,0 +1,240 @@
+#include "AnytimeAStar.h"
+#include "ConnectedComponents.h"
+#include "Landmarks.h"
+#include "SearchPolicies.h"
+#include <algorithm>
+#include <chrono>
+
+namespace {
+    const int g_directionX[8] = { 0, 1, 0, -1, 1, 1, -1, -1 };
+    const int g_directionY[8] = { -1, 0, 1, 0, -1, 1, 1, -1 };
+}
+
+void AnytimeAStar::Init(const MapView& map, const SearchConfig& config, int startX, int startY, int targetX, int targetY) {
+    m_grid = map.grid;
+    m_terrain = map.terrain;
+    m_heuristicScale = m_terrain ? m_terrain->GetMinWeight() : 1;
+    m_diagonalMovement = config.diagonalMovement;
+    m_landmarks = (map.landmarks && map.landmarks->Matches(m_grid->width, m_grid->height, m_diagonalMovement)) ? map.landmarks : nullptr;
+    if (m_nodes.width != m_grid->width || m_nodes.height != m_grid->height) {
+        m_nodes.Resize(m_grid->width, m_grid->height);
+    }
+    m_openList.Init(&m_nodes, config.openList);
+    m_nodes.NewGeneration();
+    m_closedList.clear();
+    m_inconsistent.clear();
+    m_path.clear();
+    m_pathCost = INT_MAX;
+    m_pathRevision = 0;
+    m_bound = 0.0f;
+    m_expansions = 0;
+    m_epsilon = ARA_INITIAL_EPSILON;
+    m_finished = false;
+    m_start = m_nodes.GetIndex(startX, startY);
+    m_target = m_nodes.GetIndex(targetX, targetY);
+    m_nodes.Touch(m_target);
+    m_nodes.Touch(m_start);
+    m_nodes.g[m_start] = 0;
+    m_nodes.f[m_start] = GetInflatedF(m_start);
+    m_nodes.state[m_start] = NODE_OPEN;
+    m_openList.AddItem(m_start);
+    if (m_grid->IsBlocked(targetX, targetY) || (map.components && map.components->Matches(m_grid->width, m_grid->height, m_diagonalMovement) &&
+        !m_grid->IsBlocked(startX, startY) && !map.components->IsReachable(startX, startY, targetX, targetY))) {
+        m_openList.Clear();
+    }
+}
+
+void AnytimeAStar::Clear() {
+    m_grid = nullptr;
+    m_path.clear();
+    m_pathCost = INT_MAX;
+    m_bound = 0.0f;
+    m_finished = false;
+}
+
+// Expands at most maxExpansions nodes, and stops early once maxMicroseconds have passed if that is set.
+// Rounds follow each other within one call, so a generous budget can go all the way to the optimal path.
+SearchStatus AnytimeAStar::Improve(int maxExpansions, int maxMicroseconds) {
+    if (!IsInitialized()) {
+        return SEARCH_NO_PATH;
+    }
+    std::chrono::steady_clock::time_point startTime;
+    if (maxMicroseconds > 0) {
+        startTime = std::chrono::steady_clock::now();
+    }
+    for (int i = 0; i < maxExpansions && !m_finished; i++) {
+        if (IsRoundFinished()) {
+            FinishRound();
+            if (m_finished) {
+                break;
+            }
+            StartNextRound();
+            continue;
+        }
+        Expand();
+        if (maxMicroseconds > 0 && i % SEARCH_CLOCK_INTERVAL == SEARCH_CLOCK_INTERVAL - 1) {
+            auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime);
+            if (elapsed.count() >= maxMicroseconds) {
+                break;
+            }
+        }
+    }
+    if (m_finished) {
+        return PathFound() ? SEARCH_FOUND : SEARCH_NO_PATH;
+    }
+    return SEARCH_RUNNING;
+}
+
+bool AnytimeAStar::IsInitialized() const {
+    return m_grid != nullptr;
+}
+
+bool AnytimeAStar::PathFound() const {
+    return m_pathCost != INT_MAX;
+}
+
+// Either the path is proven optimal or there is none
+bool AnytimeAStar::IsFinished() const {
+    return m_finished;
+}
+
+const std::vector<int>& AnytimeAStar::GetPath() const {
+    return m_path;
+}
+
+int AnytimeAStar::GetPathCost() const {
+    return m_pathCost;
+}
+
+int AnytimeAStar::GetPathRevision() const {
+    return m_pathRevision;
+}
+
+float AnytimeAStar::GetEpsilon() const {
+    return m_epsilon;
+}
+
+float AnytimeAStar::GetSuboptimalityBound() const {
+    return m_bound;
+}
+
+int AnytimeAStar::GetExpansions() const {
+    return m_expansions;
+}
+
+// The target can't get cheaper this round once nothing open has a lower inflated f
+bool AnytimeAStar::IsRoundFinished() {
+    return m_openList.IsEmpty() || m_nodes.g[m_target] <= m_nodes.f[m_openList.PeekFirst()];
+}
+
+// Publishes the path and works out how far from optimal it can be. Every cheaper path has to go through
+// a node that is open or inconsistent, so the lowest g + h among them bounds the optimal cost from below.
+void AnytimeAStar::FinishRound() {
+    if (m_nodes.g[m_target] == INT_MAX) {
+        m_finished = true;
+        return;
+    }
+    // Nodes along the way can have got cheaper since the target's g was set, so the path is costed as walked
+    m_path.clear();
+    m_pathCost = 0;
+    for (int node = m_target; node != m_start; node = m_nodes.parent[node]) {
+        m_path.push_back(node);
+        m_pathCost += GetStepCost(m_nodes.parent[node], node);
+    }
+    std::reverse(m_path.begin(), m_path.end());
+    m_pathRevision++;
+
+    std::vector<int> frontier;
+    m_openList.GetItems(frontier);
+    frontier.insert(frontier.end(), m_inconsistent.begin(), m_inconsistent.end());
+    int lowerBound = m_pathCost;
+    for (int node : frontier) {
+        lowerBound = std::min(lowerBound, m_nodes.g[node] + GetH(node));
+    }
+    m_bound = (lowerBound > 0) ? std::min(m_epsilon, (float)m_pathCost / lowerBound) : 1.0f;
+    if (m_epsilon <= 1.0f || m_bound <= 1.0f) {
+        m_bound = 1.0f;
+        m_finished = true;
+    }
+}
+
+// Lowers epsilon, brings the inconsistent nodes back and re-keys everything open for the new weight
+void AnytimeAStar::StartNextRound() {
+    m_epsilon = std::max(1.0f, m_epsilon - ARA_EPSILON_STEP);
+    std::vector<int> open;
+    m_openList.GetItems(open);
+    open.insert(open.end(), m_inconsistent.begin(), m_inconsistent.end());
+    for (int node : m_closedList) {
+        if (m_nodes.state[node] == NODE_CLOSED) {
+            m_nodes.state[node] = NODE_UNVISITED;
+        }
+    }
+    m_closedList.clear();
+    m_inconsistent.clear();
+    m_openList.Clear();
+    for (int node : open) {
+        m_nodes.f[node] = GetInflatedF(node);
+        m_nodes.state[node] = NODE_OPEN;
+        m_openList.AddItem(node);
+    }
+}
+
+void AnytimeAStar::Expand() {
+    int current = m_openList.RemoveFirst();
+    m_nodes.state[current] = NODE_CLOSED;
+    m_closedList.push_back(current);
+    m_expansions++;
+    int x = m_nodes.GetX(current);
+    int y = m_nodes.GetY(current);
+    int directionCount = (m_diagonalMovement == DIAGONAL_NEVER) ? 4 : 8;
+    for (int direction = 0; direction < directionCount; direction++) {
+        int dx = g_directionX[direction];
+        int dy = g_directionY[direction];
+        if (!m_grid->CanStep(x, y, dx, dy, m_diagonalMovement)) {
+            continue;
+        }
+        int neighbour = m_nodes.GetIndex(x + dx, y + dy);
+        int newG = m_nodes.g[current] + GetStepCost(current, neighbour);
+        m_nodes.Touch(neighbour);
+        if (newG >= m_nodes.g[neighbour]) {
+            continue;
+        }
+        m_nodes.g[neighbour] = newG;
+        m_nodes.parent[neighbour] = current;
+        // Nodes already expanded this round wait for the next one instead of being expanded twice
+        if (m_nodes.state[neighbour] == NODE_CLOSED) {
+            m_nodes.state[neighbour] = NODE_INCONSISTENT;
+            m_inconsistent.push_back(neighbour);
+        }
+        else if (m_nodes.state[neighbour] == NODE_OPEN) {
+            m_nodes.f[neighbour] = GetInflatedF(neighbour);
+            m_openList.Update(neighbour);
+        }
+        else if (m_nodes.state[neighbour] == NODE_UNVISITED) {
+            m_nodes.f[neighbour] = GetInflatedF(neighbour);
+            m_nodes.state[neighbour] = NODE_OPEN;
+            m_openList.AddItem(neighbour);
+        }
+    }
+}
+
+int AnytimeAStar::GetStepCost(int indexA, int indexB) {
+    bool diagonal = m_nodes.GetX(indexA) != m_nodes.GetX(indexB) && m_nodes.GetY(indexA) != m_nodes.GetY(indexB);
+    int cost = diagonal ? DIAGONAL_COST : ORTHOGONAL_COST;
+    return m_terrain ? m_terrain->GetStepCost(indexA, indexB, cost) : cost;
+}
+
+// Same bound plain A* uses: the movement rule's exact open-grid distance, tightened by landmarks
+int AnytimeAStar::GetH(int index) {
+    int dstX = m_nodes.GetX(index) - m_nodes.GetX(m_target);
+    int dstY = m_nodes.GetY(index) - m_nodes.GetY(m_target);
+    int h = ((m_diagonalMovement == DIAGONAL_NEVER) ? ManhattanHeuristic::Get(dstX, dstY) : OctileHeuristic::Get(dstX, dstY)) * m_heuristicScale;
+    if (m_landmarks) {
+        h = std::max(h, m_landmarks->GetLowerBound(index, m_target));
+    }
+    return h;
+}
+
+int AnytimeAStar::GetInflatedF(int index) {
+    return m_nodes.g[index] + (int)(m_epsilon * GetH(index));
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "Pathfinding.h"
+
+#define ARA_INITIAL_EPSILON 3.0f
+#define ARA_EPSILON_STEP 0.5f
+
+// ARA* (Anytime Repairing A*). The first round weights the heuristic by epsilon, so it finds some path
+// quickly. Each later round lowers epsilon and carries on from where the last one stopped. Only nodes
+// that got cheaper since they were expanded are searched again. Every finished round publishes its
+// path, and the cost is known to be within GetSuboptimalityBound() times the shortest.
+struct AnytimeAStar {
+    void Init(const MapView& map, const SearchConfig& config, int startX, int startY, int targetX, int targetY);
+    void Clear();
+    SearchStatus Improve(int maxExpansions, int maxMicroseconds = 0);
+    bool IsInitialized() const;
+    bool PathFound() const;
+    bool IsFinished() const;
+    const std::vector<int>& GetPath() const;
+    int GetPathCost() const;
+    int GetPathRevision() const;
+    float GetEpsilon() const;
+    float GetSuboptimalityBound() const;
+    int GetExpansions() const;
+
+private:
+    bool IsRoundFinished();
+    void FinishRound();
+    void StartNextRound();
+    void Expand();
+    int GetStepCost(int indexA, int indexB);
+    int GetH(int index);
+    int GetInflatedF(int index);
+
+    const ObstacleGrid* m_grid = nullptr;
+    const LandmarkTable* m_landmarks = nullptr;
+    const TerrainCosts* m_terrain = nullptr;
+    DiagonalMovement m_diagonalMovement = DIAGONAL_NEVER;
+    int m_heuristicScale = 1;
+    int m_start = -1;
+    int m_target = -1;
+    float m_epsilon = ARA_INITIAL_EPSILON;
+    float m_bound = 0.0f;           // Of the published path, 0 until there is one
+    bool m_finished = false;
+    int m_expansions = 0;           // Over every round
+    int m_pathRevision = 0;         // Goes up whenever a round publishes a path
+    int m_pathCost = INT_MAX;
+    std::vector<int> m_path;        // Cell indices excluding the start, the best path so far
+    NodeStore m_nodes;
+    OpenList m_openList;
+    std::vector<int> m_closedList;  // Closed this round, reopened for the next one
+    std::vector<int> m_inconsistent; // Closed this round and cheaper since, waiting for the next round
+};
@@ -0,0 +1,257 @@
+#include "ConnectedComponents.h"
+#include <algorithm>
+
+namespace {
+    const int g_directionX[8] = { 0, 1, 0, -1, 1, 1, -1, -1 };
+    const int g_directionY[8] = { -1, 0, 1, 0, -1, 1, 1, -1 };
+}
+
+void ConnectedComponents::Build(const ObstacleGrid& grid, DiagonalMovement diagonalMovement) {
+    m_grid = &grid;
+    m_diagonalMovement = diagonalMovement;
+    m_width = grid.width;
+    m_height = grid.height;
+    m_labels.assign(m_width * m_height, -1);
+    m_parents.clear();
+    m_ranks.clear();
+    m_groups.assign(m_width * m_height, 0);
+    m_visits.assign(m_width * m_height, 0);
+    m_visitStamp = 0;
+    std::vector<int> queue;
+    int neighbours[8];
+    for (int index = 0; index < m_width * m_height; index++) {
+        if (m_labels[index] != -1 || grid.IsBlocked(index % m_width, index / m_width)) {
+            continue;
+        }
+        int label = NewLabel();
+        m_labels[index] = label;
+        queue.clear();
+        queue.push_back(index);
+        for (int i = 0; i < queue.size(); i++) {
+            int neighbourCount = GetNeighbours(queue[i] % m_width, queue[i] / m_width, neighbours);
+            for (int j = 0; j < neighbourCount; j++) {
+                if (m_labels[neighbours[j]] == -1) {
+                    m_labels[neighbours[j]] = label;
+                    queue.push_back(neighbours[j]);
+                }
+            }
+        }
+    }
+}
+
+bool ConnectedComponents::IsBuilt() const {
+    return m_grid != nullptr;
+}
+
+bool ConnectedComponents::Matches(int mapWidth, int mapHeight, DiagonalMovement diagonalMovement) const {
+    return IsBuilt() && m_width == mapWidth && m_height == mapHeight && m_diagonalMovement == diagonalMovement;
+}
+
+// Call after the cell at x, y was toggled on the grid
+void ConnectedComponents::UpdateCell(const ObstacleGrid& grid, int x, int y) {
+    m_grid = &grid;
+    int index = y * m_width + x;
+    if (grid.IsBlocked(x, y) && m_labels[index] != -1) {
+        CloseCell(x, y);
+    }
+    else if (!grid.IsBlocked(x, y) && m_labels[index] == -1) {
+        OpenCell(x, y);
+    }
+    // Every edit can leave labels behind, so start over once they outnumber the cells
+    if (m_parents.size() > m_labels.size() * 2 + 64) {
+        Build(grid, m_diagonalMovement);
+    }
+}
+
+// Never compresses, so any number of threads can ask while nobody edits
+bool ConnectedComponents::IsReachable(int startX, int startY, int targetX, int targetY) const {
+    int startComponent = GetComponent(startX, startY);
+    return startComponent != -1 && startComponent == GetComponent(targetX, targetY);
+}
+
+// Root label of the cell, -1 for walls and cells off the map
+int ConnectedComponents::GetComponent(int x, int y) const {
+    if (x < 0 || y < 0 || x >= m_width || y >= m_height || m_labels[y * m_width + x] == -1) {
+        return -1;
+    }
+    return FindRoot(m_labels[y * m_width + x]);
+}
+
+int ConnectedComponents::NewLabel() {
+    m_parents.push_back((int)m_parents.size());
+    m_ranks.push_back(0);
+    return (int)m_parents.size() - 1;
+}
+
+int ConnectedComponents::FindRoot(int label) const {
+    while (m_parents[label] != label) {
+        label = m_parents[label];
+    }
+    return label;
+}
+
+int ConnectedComponents::FindRootAndCompress(int label) {
+    int root = FindRoot(label);
+    while (m_parents[label] != root) {
+        int next = m_parents[label];
+        m_parents[label] = root;
+        label = next;
+    }
+    return root;
+}
+
+void ConnectedComponents::Join(int labelA, int labelB) {
+    int rootA = FindRootAndCompress(labelA);
+    int rootB = FindRootAndCompress(labelB);
+    if (rootA == rootB) {
+        return;
+    }
+    if (m_ranks[rootA] < m_ranks[rootB]) {
+        std::swap(rootA, rootB);
+    }
+    m_parents[rootB] = rootA;
+    if (m_ranks[rootA] == m_ranks[rootB]) {
+        m_ranks[rootA]++;
+    }
+}
+
+// Any step the new cell makes possible is either to the cell itself or between two of its orthogonal
+// neighbours, which can now go through it anyway. So joining it with its neighbours is enough.
+void ConnectedComponents::OpenCell(int x, int y) {
+    int label = NewLabel();
+    m_labels[y * m_width + x] = label;
+    int neighbours[8];
+    int neighbourCount = GetNeighbours(x, y, neighbours);
+    for (int i = 0; i < neighbourCount; i++) {
+        Join(label, m_labels[neighbours[i]]);
+    }
+}
+
+void ConnectedComponents::CloseCell(int x, int y) {
+    int oldRoot = FindRootAndCompress(m_labels[y * m_width + x]);
+    m_labels[y * m_width + x] = -1;
+
+    // Open cells around it from the same component, grouped by whether they still connect inside the 3x3 block
+    int ring[8];
+    int ringGroups[8];
+    int ringCount = 0;
+    for (int direction = 0; direction < 8; direction++) {
+        int ringX = x + g_directionX[direction];
+        int ringY = y + g_directionY[direction];
+        if (ringX < 0 || ringY < 0 || ringX >= m_width || ringY >= m_height || m_labels[ringY * m_width + ringX] == -1) {
+            continue;
+        }
+        if (FindRoot(m_labels[ringY * m_width + ringX]) == oldRoot) {
+            ring[ringCount] = ringY * m_width + ringX;
+            ringGroups[ringCount] = ringCount;
+            ringCount++;
+        }
+    }
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (int i = 0; i < ringCount; i++) {
+            for (int j = i + 1; j < ringCount; j++) {
+                int dx = ring[j] % m_width - ring[i] % m_width;
+                int dy = ring[j] / m_width - ring[i] / m_width;
+                if (ringGroups[i] != ringGroups[j] && std::abs(dx) <= 1 && std::abs(dy) <= 1 && m_grid->CanStep(ring[i] % m_width, ring[i] / m_width, dx, dy, m_diagonalMovement)) {
+                    int from = std::max(ringGroups[i], ringGroups[j]);
+                    int to = std::min(ringGroups[i], ringGroups[j]);
+                    for (int k = 0; k < ringCount; k++) {
+                        if (ringGroups[k] == from) {
+                            ringGroups[k] = to;
+                        }
+                    }
+                    merged = true;
+                }
+            }
+        }
+    }
+    std::vector<int> seeds;
+    for (int i = 0; i < ringCount; i++) {
+        if (ringGroups[i] == i) {
+            seeds.push_back(ring[i]);
+        }
+    }
+    if (seeds.size() <= 1) {
+        return;
+    }
+
+    // The groups might still meet further out. Flood from all of them a cell at a time, merging floods
+    // that meet. A flood that runs out first is a separate component and gets a new label, and the last
+    // one left keeps the old labels, so the work is bounded by the smaller pieces.
+    m_visitStamp++;
+    if (m_visitStamp == 0) {
+        std::fill(m_visits.begin(), m_visits.end(), 0);
+        m_visitStamp = 1;
+    }
+    int groupCount = (int)seeds.size();
+    std::vector<std::vector<int>> members(groupCount);
+    std::vector<std::vector<int>> queues(groupCount);
+    std::vector<int> heads(groupCount, 0);
+    std::vector<int> owners(groupCount);
+    std::vector<bool> finished(groupCount, false);
+    for (int group = 0; group < groupCount; group++) {
+        owners[group] = group;
+        members[group].push_back(seeds[group]);
+        queues[group].push_back(seeds[group]);
+        m_visits[seeds[group]] = m_visitStamp;
+        m_groups[seeds[group]] = group;
+    }
+    int aliveCount = groupCount;
+    int neighbours[8];
+    while (aliveCount > 1) {
+        for (int group = 0; group < groupCount && aliveCount > 1; group++) {
+            if (owners[group] != group || finished[group]) {
+                continue;
+            }
+            if (heads[group] == queues[group].size()) {
+                int label = NewLabel();
+                for (int cell : members[group]) {
+                    m_labels[cell] = label;
+                }
+                finished[group] = true;
+                aliveCount--;
+                continue;
+            }
+            int cell = queues[group][heads[group]++];
+            int neighbourCount = GetNeighbours(cell % m_width, cell / m_width, neighbours);
+            for (int i = 0; i < neighbourCount; i++) {
+                int neighbour = neighbours[i];
+                if (m_visits[neighbour] != m_visitStamp) {
+                    m_visits[neighbour] = m_visitStamp;
+                    m_groups[neighbour] = group;
+                    members[group].push_back(neighbour);
+                    queues[group].push_back(neighbour);
+                    continue;
+                }
+                int other = m_groups[neighbour];
+                while (owners[other] != other) {
+                    other = owners[other];
+                }
+                if (other != group) {
+                    owners[other] = group;
+                    members[group].insert(members[group].end(), members[other].begin(), members[other].end());
+                    queues[group].insert(queues[group].end(), queues[other].begin() + heads[other], queues[other].end());
+                    members[other].clear();
+                    queues[other].clear();
+                    aliveCount--;
+                }
+            }
+        }
+    }
+}
+
+// Steps are symmetric, so these are the cells connected to an open cell in one step
+int ConnectedComponents::GetNeighbours(int x, int y, int* neighbours) const {
+    int directionCount = (m_diagonalMovement == DIAGONAL_NEVER) ? 4 : 8;
+    int neighbourCount = 0;
+    for (int direction = 0; direction < directionCount; direction++) {
+        int dx = g_directionX[direction];
+        int dy = g_directionY[direction];
+        if (m_grid->CanStep(x, y, dx, dy, m_diagonalMovement)) {
+            neighbours[neighbourCount++] = (y + dy) * m_width + x + dx;
+        }
+    }
+    return neighbourCount;
+}
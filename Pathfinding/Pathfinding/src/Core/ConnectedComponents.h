@@ -0,0 +1,35 @@
+#pragma once
+#include "Pathfinding.h"
+
+// Which cells can reach each other. Every open cell has a label and labels are joined in a union-find, so
+// two cells are connected exactly when their labels share a root. Opening a cell only ever joins
+// components. Closing one can split them, but only if the open cells around it stop being connected
+// locally, and then only the smaller side is relabelled.
+struct ConnectedComponents {
+    void Build(const ObstacleGrid& grid, DiagonalMovement diagonalMovement);
+    void UpdateCell(const ObstacleGrid& grid, int x, int y);
+    bool IsBuilt() const;
+    bool Matches(int mapWidth, int mapHeight, DiagonalMovement diagonalMovement) const;
+    bool IsReachable(int startX, int startY, int targetX, int targetY) const;
+    int GetComponent(int x, int y) const;
+
+private:
+    int NewLabel();
+    int FindRoot(int label) const;
+    int FindRootAndCompress(int label);
+    void Join(int labelA, int labelB);
+    void OpenCell(int x, int y);
+    void CloseCell(int x, int y);
+    int GetNeighbours(int x, int y, int* neighbours) const;
+
+    const ObstacleGrid* m_grid = nullptr;
+    DiagonalMovement m_diagonalMovement = DIAGONAL_NEVER;
+    int m_width = 0;
+    int m_height = 0;
+    std::vector<int> m_labels;      // Per cell, -1 for walls
+    std::vector<int> m_parents;     // Per label
+    std::vector<uint8_t> m_ranks;   // Per label, keeps the trees shallow enough for lookups that don't compress
+    std::vector<int> m_groups;      // Per cell, scratch space for splits
+    std::vector<uint32_t> m_visits; // Per cell, the split that last wrote m_groups
+    uint32_t m_visitStamp = 0;
+};
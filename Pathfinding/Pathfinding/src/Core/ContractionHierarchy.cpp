@@ -0,0 +1,410 @@
+#include "ContractionHierarchy.h"
+#include <algorithm>
+#include <atomic>
+#include <istream>
+#include <ostream>
+#include <thread>
+
+namespace {
+    const int g_directionX[8] = { 0, 1, 0, -1, 1, 1, -1, -1 };
+    const int g_directionY[8] = { -1, 0, 1, 0, -1, 1, 1, -1 };
+
+    struct Shortcut {
+        int from = -1;
+        int to = -1;
+        int cost = 0;
+        int middle = -1;
+    };
+
+    // Scratch space for the witness searches of one thread
+    struct WitnessSearch {
+        NodeStore nodes;
+        OpenList openList;
+    };
+
+    using Graph = std::vector<std::vector<ContractionEdge>>;
+
+    // Calls function(search, i) for every i below count, spread over one thread per search
+    template <typename Function>
+    void ParallelFor(int count, std::vector<WitnessSearch>& searches, Function function) {
+        std::atomic<int> next = 0;
+        auto worker = [&](WitnessSearch& search) {
+            for (int i = next++; i < count; i = next++) {
+                function(search, i);
+            }
+        };
+        // Not worth waking threads for a handful of nodes
+        int threadCount = std::min((int)searches.size(), 1 + count / 64);
+        std::vector<std::thread> threads;
+        for (int i = 1; i < threadCount; i++) {
+            threads.emplace_back(worker, std::ref(searches[i]));
+        }
+        worker(searches[0]);
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+
+    // Dijkstra from source that never enters skipped or an excluded cell, and stops past limit or after
+    // CH_WITNESS_SETTLE_LIMIT settled cells. Any g it leaves behind is the cost of a real path.
+    void FindWitnesses(const Graph& graph, int source, int skipped, const std::vector<uint8_t>* excluded, int limit, WitnessSearch& search) {
+        NodeStore& nodes = search.nodes;
+        search.openList.Clear();
+        nodes.NewGeneration();
+        nodes.Touch(source);
+        nodes.g[source] = 0;
+        nodes.f[source] = 0;
+        nodes.state[source] = NODE_OPEN;
+        search.openList.AddItem(source);
+        for (int settled = 0; settled < CH_WITNESS_SETTLE_LIMIT && !search.openList.IsEmpty(); settled++) {
+            int current = search.openList.RemoveFirst();
+            if (nodes.g[current] > limit) {
+                break;
+            }
+            nodes.state[current] = NODE_CLOSED;
+            for (const ContractionEdge& edge : graph[current]) {
+                if (edge.to == skipped || (excluded && (*excluded)[edge.to])) {
+                    continue;
+                }
+                nodes.Touch(edge.to);
+                int newG = nodes.g[current] + edge.cost;
+                if (nodes.state[edge.to] == NODE_CLOSED || newG >= nodes.g[edge.to]) {
+                    continue;
+                }
+                nodes.g[edge.to] = newG;
+                nodes.f[edge.to] = newG;
+                if (nodes.state[edge.to] == NODE_OPEN) {
+                    search.openList.Update(edge.to);
+                }
+                else {
+                    nodes.state[edge.to] = NODE_OPEN;
+                    search.openList.AddItem(edge.to);
+                }
+            }
+        }
+    }
+
+    // Shortcuts contracting node would need: one for every pair of its neighbours whose only shortest
+    // path in the remaining graph goes through it. Returns how many.
+    int FindShortcuts(const Graph& graph, int node, const std::vector<uint8_t>* excluded, WitnessSearch& search, std::vector<Shortcut>* shortcuts) {
+        const std::vector<ContractionEdge>& edges = graph[node];
+        int maxCost = 0;
+        for (const ContractionEdge& edge : edges) {
+            maxCost = std::max(maxCost, edge.cost);
+        }
+        int count = 0;
+        // Steps are symmetric, so each pair is only searched from its first neighbour
+        for (int i = 0; i + 1 < (int)edges.size(); i++) {
+            FindWitnesses(graph, edges[i].to, node, excluded, edges[i].cost + maxCost, search);
+            for (int j = i + 1; j < (int)edges.size(); j++) {
+                int cost = edges[i].cost + edges[j].cost;
+                search.nodes.Touch(edges[j].to);
+                if (search.nodes.g[edges[j].to] > cost) {
+                    count++;
+                    if (shortcuts) {
+                        shortcuts->push_back({ edges[i].to, edges[j].to, cost, node });
+                    }
+                }
+            }
+        }
+        return count;
+    }
+
+    // Adds the edge from one end, or lowers the one already there
+    void SetEdge(std::vector<ContractionEdge>& edges, int to, int cost, int middle) {
+        for (ContractionEdge& edge : edges) {
+            if (edge.to == to) {
+                if (cost < edge.cost) {
+                    edge.cost = cost;
+                    edge.middle = middle;
+                }
+                return;
+            }
+        }
+        edges.push_back({ to, cost, middle });
+    }
+
+    void RemoveEdge(std::vector<ContractionEdge>& edges, int to) {
+        for (int i = 0; i < (int)edges.size(); i++) {
+            if (edges[i].to == to) {
+                edges[i] = edges.back();
+                edges.pop_back();
+                return;
+            }
+        }
+    }
+
+    template <typename T>
+    void WriteValue(std::ostream& out, const T& value) {
+        out.write((const char*)&value, sizeof(T));
+    }
+
+    template <typename T>
+    void WriteVector(std::ostream& out, const std::vector<T>& values) {
+        WriteValue(out, (uint64_t)values.size());
+        out.write((const char*)values.data(), values.size() * sizeof(T));
+    }
+
+    template <typename T>
+    bool ReadValue(std::istream& in, T& value) {
+        return (bool)in.read((char*)&value, sizeof(T));
+    }
+
+    template <typename T>
+    bool ReadVector(std::istream& in, std::vector<T>& values, uint64_t maxSize) {
+        uint64_t size = 0;
+        if (!ReadValue(in, size) || size > maxSize) {
+            return false;
+        }
+        values.resize(size);
+        return (bool)in.read((char*)values.data(), size * sizeof(T));
+    }
+}
+
+// Contracts the cells in rounds. Every round the priority of each cell whose neighbourhood changed is
+// worked out in parallel by simulating its contraction, then every cell that beats all its neighbours is
+// contracted. No two of those are adjacent, so their shortcuts can be found in parallel too, as long as
+// the witness searches keep away from all of them.
+void ContractionHierarchy::Build(const ObstacleGrid& grid, DiagonalMovement diagonalMovement, const TerrainCosts* terrain) {
+    width = grid.width;
+    height = grid.height;
+    this->diagonalMovement = diagonalMovement;
+    mapHash = HashMap(grid, terrain);
+    int cellCount = width * height;
+    ranks.assign(cellCount, -1);
+
+    Graph graph(cellCount);
+    std::vector<int> remaining;
+    int directionCount = (diagonalMovement == DIAGONAL_NEVER) ? 4 : 8;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            if (grid.IsBlocked(x, y)) {
+                continue;
+            }
+            int index = y * width + x;
+            remaining.push_back(index);
+            for (int direction = 0; direction < directionCount; direction++) {
+                int dx = g_directionX[direction];
+                int dy = g_directionY[direction];
+                if (!grid.CanStep(x, y, dx, dy, diagonalMovement)) {
+                    continue;
+                }
+                int neighbour = (y + dy) * width + x + dx;
+                int cost = (dx != 0 && dy != 0) ? DIAGONAL_COST : ORTHOGONAL_COST;
+                if (terrain) {
+                    cost = terrain->GetStepCost(index, neighbour, cost);
+                }
+                graph[index].push_back({ neighbour, cost, -1 });
+            }
+        }
+    }
+
+    std::vector<WitnessSearch> searches(std::max(1, (int)std::thread::hardware_concurrency()));
+    for (WitnessSearch& search : searches) {
+        search.nodes.Resize(width, height);
+        search.openList.Init(&search.nodes, OPEN_LIST_QUATERNARY_HEAP);
+    }
+    std::vector<int> priorities(cellCount, 0);
+    std::vector<int> contractedNeighbours(cellCount, 0);
+    std::vector<int> levels(cellCount, 0);  // Longest chain of contracted cells below, keeps the hierarchy shallow
+    std::vector<uint8_t> inRound(cellCount, 0);
+    std::vector<uint8_t> changed(cellCount, 0);
+    std::vector<std::vector<ContractionEdge>> upward(cellCount);
+    std::vector<int> toUpdate = remaining;
+    int nextRank = 0;
+
+    while (!remaining.empty()) {
+        ParallelFor((int)toUpdate.size(), searches, [&](WitnessSearch& search, int i) {
+            int node = toUpdate[i];
+            int edgeDifference = FindShortcuts(graph, node, nullptr, search, nullptr) - (int)graph[node].size();
+            priorities[node] = 2 * edgeDifference + contractedNeighbours[node] + levels[node];
+        });
+
+        std::vector<int> round;
+        for (int node : remaining) {
+            bool lowest = true;
+            for (const ContractionEdge& edge : graph[node]) {
+                if (priorities[edge.to] < priorities[node] || (priorities[edge.to] == priorities[node] && edge.to < node)) {
+                    lowest = false;
+                    break;
+                }
+            }
+            if (lowest) {
+                round.push_back(node);
+                inRound[node] = 1;
+            }
+        }
+
+        std::vector<std::vector<Shortcut>> shortcuts(round.size());
+        ParallelFor((int)round.size(), searches, [&](WitnessSearch& search, int i) {
+            FindShortcuts(graph, round[i], &inRound, search, &shortcuts[i]);
+        });
+
+        toUpdate.clear();
+        for (int i = 0; i < (int)round.size(); i++) {
+            int node = round[i];
+            ranks[node] = nextRank++;
+            for (const ContractionEdge& edge : graph[node]) {
+                RemoveEdge(graph[edge.to], node);
+                contractedNeighbours[edge.to]++;
+                levels[edge.to] = std::max(levels[edge.to], levels[node] + 1);
+                if (!changed[edge.to]) {
+                    changed[edge.to] = 1;
+                    toUpdate.push_back(edge.to);
+                }
+            }
+            for (const Shortcut& shortcut : shortcuts[i]) {
+                SetEdge(graph[shortcut.from], shortcut.to, shortcut.cost, shortcut.middle);
+                SetEdge(graph[shortcut.to], shortcut.from, shortcut.cost, shortcut.middle);
+            }
+            // Everything still attached was contracted later, so these are exactly its upward edges
+            upward[node] = std::move(graph[node]);
+            graph[node].clear();
+            inRound[node] = 0;
+        }
+        for (int node : toUpdate) {
+            changed[node] = 0;
+        }
+        remaining.erase(std::remove_if(remaining.begin(), remaining.end(), [&](int node) { return ranks[node] != -1; }), remaining.end());
+    }
+
+    firstEdge.assign(cellCount + 1, 0);
+    edges.clear();
+    for (int index = 0; index < cellCount; index++) {
+        firstEdge[index] = (int)edges.size();
+        edges.insert(edges.end(), upward[index].begin(), upward[index].end());
+    }
+    firstEdge[cellCount] = (int)edges.size();
+}
+
+bool ContractionHierarchy::IsBuilt() const {
+    return !firstEdge.empty();
+}
+
+// Only says the size and movement rules fit. Whether the walls and terrain still do is up to the owner,
+// by rebuilding or dropping it after edits and comparing HashMap on load.
+bool ContractionHierarchy::Matches(int mapWidth, int mapHeight, DiagonalMovement diagonalMovement) const {
+    return IsBuilt() && width == mapWidth && height == mapHeight && this->diagonalMovement == diagonalMovement;
+}
+
+int ContractionHierarchy::GetShortcutCount() const {
+    return (int)std::count_if(edges.begin(), edges.end(), [](const ContractionEdge& edge) { return edge.middle != -1; });
+}
+
+// Appends the cells from one end of an edge to the other, excluding from and including to. Shortcuts are
+// split at the cell they skip until only single steps are left. Returns false if an edge is missing.
+bool ContractionHierarchy::Unpack(int from, int to, std::vector<int>& path) const {
+    std::vector<glm::ivec2> pending = { glm::ivec2(from, to) };
+    while (!pending.empty()) {
+        glm::ivec2 edge = pending.back();
+        pending.pop_back();
+        const ContractionEdge* found = FindEdge(edge.x, edge.y);
+        if (!found) {
+            return false;
+        }
+        int middle = found->middle;
+        if (middle == -1) {
+            path.push_back(edge.y);
+        }
+        else {
+            pending.push_back(glm::ivec2(middle, edge.y));
+            pending.push_back(glm::ivec2(edge.x, middle));
+        }
+    }
+    return true;
+}
+
+// The edge between two cells is stored once, with whichever of them was contracted first
+const ContractionEdge* ContractionHierarchy::FindEdge(int indexA, int indexB) const {
+    int lower = (ranks[indexA] < ranks[indexB]) ? indexA : indexB;
+    int upper = (lower == indexA) ? indexB : indexA;
+    for (int i = firstEdge[lower]; i < firstEdge[lower + 1]; i++) {
+        if (edges[i].to == upper) {
+            return &edges[i];
+        }
+    }
+    return nullptr;
+}
+
+void ContractionHierarchy::Save(std::ostream& out) const {
+    WriteValue(out, (int)CH_FILE_VERSION);
+    WriteValue(out, width);
+    WriteValue(out, height);
+    WriteValue(out, (int)diagonalMovement);
+    WriteValue(out, mapHash);
+    WriteVector(out, ranks);
+    WriteVector(out, firstEdge);
+    WriteVector(out, edges);
+}
+
+// Leaves the hierarchy unbuilt if the data is from another version or doesn't hang together
+bool ContractionHierarchy::Load(std::istream& in) {
+    *this = ContractionHierarchy();
+    int version = 0;
+    int movement = 0;
+    ContractionHierarchy loaded;
+    if (!ReadValue(in, version) || version != CH_FILE_VERSION || !ReadValue(in, loaded.width) || !ReadValue(in, loaded.height) ||
+        !ReadValue(in, movement) || movement < 0 || movement >= DIAGONAL_MOVEMENT_COUNT || !ReadValue(in, loaded.mapHash)) {
+        return false;
+    }
+    loaded.diagonalMovement = (DiagonalMovement)movement;
+    uint64_t cellCount = (uint64_t)std::max(0, loaded.width) * std::max(0, loaded.height);
+    if (!ReadVector(in, loaded.ranks, cellCount) || !ReadVector(in, loaded.firstEdge, cellCount + 1) ||
+        !ReadVector(in, loaded.edges, INT_MAX)) {
+        return false;
+    }
+    if (loaded.ranks.size() != cellCount || loaded.firstEdge.size() != cellCount + 1 || !loaded.IsConsistent()) {
+        return false;
+    }
+    *this = std::move(loaded);
+    return true;
+}
+
+// Whether queries and unpacking can trust the data. Every edge has to lead up, and every shortcut has to
+// skip a lower cell joined to both its ends, so unpacking always finds its edges and always finishes.
+bool ContractionHierarchy::IsConsistent() const {
+    int cellCount = (int)ranks.size();
+    for (int rank : ranks) {
+        if (rank < -1 || rank >= cellCount) {
+            return false;
+        }
+    }
+    if (firstEdge[0] != 0 || firstEdge[cellCount] != (int)edges.size()) {
+        return false;
+    }
+    for (int index = 0; index < cellCount; index++) {
+        if (firstEdge[index] < 0 || firstEdge[index] > firstEdge[index + 1]) {
+            return false;
+        }
+        if (firstEdge[index] != firstEdge[index + 1] && ranks[index] == -1) {
+            return false;
+        }
+        for (int i = firstEdge[index]; i < firstEdge[index + 1]; i++) {
+            const ContractionEdge& edge = edges[i];
+            if (edge.to < 0 || edge.to >= cellCount || ranks[edge.to] <= ranks[index] || edge.cost < 0 || edge.middle < -1 || edge.middle >= cellCount) {
+                return false;
+            }
+            if (edge.middle != -1 && (ranks[edge.middle] == -1 || ranks[edge.middle] >= ranks[index] || !FindEdge(index, edge.middle) || !FindEdge(edge.middle, edge.to))) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// FNV-1a over the walls and, if given, the terrain weights
+uint64_t ContractionHierarchy::HashMap(const ObstacleGrid& grid, const TerrainCosts* terrain) {
+    uint64_t hash = 14695981039346656037ull;
+    auto add = [&hash](const void* data, size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ ((const uint8_t*)data)[i]) * 1099511628211ull;
+        }
+    };
+    add(&grid.width, sizeof(grid.width));
+    add(&grid.height, sizeof(grid.height));
+    add(grid.words.data(), grid.words.size() * sizeof(uint64_t));
+    if (terrain) {
+        add(terrain->weights.data(), terrain->weights.size());
+    }
+    return hash;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include "Pathfinding.h"
+#include <iosfwd>
+
+#define CH_WITNESS_SETTLE_LIMIT 128 // Nodes a witness search settles before it gives up and the shortcut is kept
+#define CH_FILE_VERSION 1
+
+struct ContractionEdge {
+    int to = -1;
+    int cost = 0;
+    int middle = -1;    // Cell the shortcut skips over, -1 for a single grid step
+};
+
+// Contraction hierarchy over the open cells. Cells are contracted one after another, each replaced by
+// shortcuts between its remaining neighbours wherever it was on their only shortest path. Only the edges
+// that lead to a cell contracted later are kept, so a query is two small Dijkstra searches climbing from
+// the start and the target that meet at the top of the path. Building is slow and any edit makes the
+// hierarchy stale, so it is meant for maps that rarely change and is saved along with them.
+struct ContractionHierarchy {
+    int width = 0;
+    int height = 0;
+    DiagonalMovement diagonalMovement = DIAGONAL_NEVER;
+    uint64_t mapHash = 0;               // Walls and terrain it was built from, see HashMap
+    std::vector<int> ranks;             // Contraction order per cell, -1 for walls
+    std::vector<int> firstEdge;         // Per cell plus one past the last, into edges
+    std::vector<ContractionEdge> edges; // Upward edges of each cell, every one leads to a higher rank
+
+    void Build(const ObstacleGrid& grid, DiagonalMovement diagonalMovement, const TerrainCosts* terrain = nullptr);
+    bool IsBuilt() const;
+    bool Matches(int mapWidth, int mapHeight, DiagonalMovement diagonalMovement) const;
+    int GetShortcutCount() const;
+    bool Unpack(int from, int to, std::vector<int>& path) const;
+    void Save(std::ostream& out) const;
+    bool Load(std::istream& in);
+
+    static uint64_t HashMap(const ObstacleGrid& grid, const TerrainCosts* terrain);
+
+private:
+    const ContractionEdge* FindEdge(int indexA, int indexB) const;
+    bool IsConsistent() const;
+};
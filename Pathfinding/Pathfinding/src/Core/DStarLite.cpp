@@ -0,0 +1,298 @@
+#include "DStarLite.h"
+#include <algorithm>
+#include <cstdlib>
+
+namespace {
+    const int g_directionX[8] = { 0, 1, 0, -1, 1, 1, -1, -1 };
+    const int g_directionY[8] = { -1, 0, 1, 0, -1, 1, 1, -1 };
+
+    int AddCost(int a, int b) {
+        return (a >= DSTAR_INFINITY || b >= DSTAR_INFINITY) ? DSTAR_INFINITY : a + b;
+    }
+}
+
+void DStarLite::Init(const ObstacleGrid& grid, int startX, int startY, int targetX, int targetY, DiagonalMovement diagonalMovement, const TerrainCosts* terrain) {
+    m_grid = &grid;
+    m_terrain = terrain;
+    m_diagonalMovement = diagonalMovement;
+    m_width = grid.width;
+    m_height = grid.height;
+    m_start = startY * m_width + startX;
+    m_target = targetY * m_width + targetX;
+    m_keyModifier = 0;
+    m_expansions = 0;
+    m_g.assign(m_width * m_height, DSTAR_INFINITY);
+    m_rhs.assign(m_width * m_height, DSTAR_INFINITY);
+    m_keys.assign(m_width * m_height, Key());
+    m_heapIndex.assign(m_width * m_height, -1);
+    m_heap.clear();
+    m_rhs[m_target] = 0;
+    HeapPush(m_target, CalculateKey(m_target));
+}
+
+void DStarLite::Clear() {
+    m_grid = nullptr;
+    m_g.clear();
+    m_rhs.clear();
+    m_keys.clear();
+    m_heapIndex.clear();
+    m_heap.clear();
+}
+
+bool DStarLite::IsInitialized() const {
+    return m_grid != nullptr;
+}
+
+// Whether the search can be kept for this target and these movement rules, or has to start over
+bool DStarLite::Matches(int targetX, int targetY, DiagonalMovement diagonalMovement) const {
+    return IsInitialized() && m_target == targetY * m_width + targetX && m_diagonalMovement == diagonalMovement && m_width == m_grid->width && m_height == m_grid->height;
+}
+
+int DStarLite::GetPathCost() const {
+    return IsInitialized() ? m_rhs[m_start] : DSTAR_INFINITY;
+}
+
+int DStarLite::GetExpansions() const {
+    return m_expansions;
+}
+
+// Queued keys stay valid lower bounds after the start moves by adding the distance it moved to every new key
+void DStarLite::MoveStart(int x, int y) {
+    int start = y * m_width + x;
+    m_keyModifier += GetH(m_start, start);
+    m_start = start;
+}
+
+// Call after the cell at x, y was toggled on the grid. Every step whose cost that can change has both ends
+// in the 3x3 block around it, so only those cells need their lookahead recalculated.
+void DStarLite::UpdateCell(int x, int y) {
+    for (int dy = -1; dy <= 1; dy++) {
+        for (int dx = -1; dx <= 1; dx++) {
+            int cellX = x + dx;
+            int cellY = y + dy;
+            if (cellX < 0 || cellY < 0 || cellX >= m_width || cellY >= m_height) {
+                continue;
+            }
+            int index = cellY * m_width + cellX;
+            if (index != m_target) {
+                int cost;
+                GetBestSuccessor(index, cost);
+                m_rhs[index] = cost;
+            }
+            UpdateVertex(index);
+        }
+    }
+}
+
+bool DStarLite::ComputeShortestPath() {
+    m_expansions = 0;
+    if (!IsInitialized()) {
+        return false;
+    }
+    int neighbours[9];
+    int costs[9];
+    while (!m_heap.empty() && (m_keys[m_heap[0]] < CalculateKey(m_start) || m_rhs[m_start] > m_g[m_start])) {
+        int index = m_heap[0];
+        Key oldKey = m_keys[index];
+        Key newKey = CalculateKey(index);
+        m_expansions++;
+        if (oldKey < newKey) {
+            HeapUpdate(index, newKey);
+        }
+        else if (m_g[index] > m_rhs[index]) {
+            // Cheaper than before, which can only make its neighbours cheaper too
+            m_g[index] = m_rhs[index];
+            HeapRemove(index);
+            int neighbourCount = GetNeighbours(index, neighbours, costs);
+            for (int i = 0; i < neighbourCount; i++) {
+                int neighbour = neighbours[i];
+                if (neighbour != m_target) {
+                    m_rhs[neighbour] = std::min(m_rhs[neighbour], AddCost(costs[i], m_g[index]));
+                    UpdateVertex(neighbour);
+                }
+            }
+        }
+        else {
+            // More expensive than before, so anything that went through it has to look again
+            int oldG = m_g[index];
+            m_g[index] = DSTAR_INFINITY;
+            int neighbourCount = GetNeighbours(index, neighbours, costs);
+            neighbours[neighbourCount] = index;
+            costs[neighbourCount] = 0;
+            for (int i = 0; i <= neighbourCount; i++) {
+                int neighbour = neighbours[i];
+                if (neighbour != m_target && m_rhs[neighbour] == AddCost(costs[i], oldG)) {
+                    int cost;
+                    GetBestSuccessor(neighbour, cost);
+                    m_rhs[neighbour] = cost;
+                }
+                UpdateVertex(neighbour);
+            }
+        }
+    }
+    return m_rhs[m_start] < DSTAR_INFINITY;
+}
+
+// Cell indices excluding the start, same as AStar::GetPath
+bool DStarLite::GetPath(std::vector<int>& path) const {
+    path.clear();
+    if (!IsInitialized() || m_rhs[m_start] >= DSTAR_INFINITY) {
+        return false;
+    }
+    int index = m_start;
+    while (index != m_target) {
+        int cost;
+        index = GetBestSuccessor(index, cost);
+        if (index == -1 || cost >= DSTAR_INFINITY || path.size() >= m_g.size()) {
+            path.clear();
+            return false;
+        }
+        path.push_back(index);
+    }
+    return true;
+}
+
+DStarLite::Key DStarLite::CalculateKey(int index) const {
+    int g = std::min(m_g[index], m_rhs[index]);
+    Key key;
+    if (g < DSTAR_INFINITY) {
+        key.primary = g + GetH(m_start, index) + m_keyModifier;
+        key.secondary = g;
+    }
+    return key;
+}
+
+void DStarLite::UpdateVertex(int index) {
+    if (m_g[index] != m_rhs[index]) {
+        if (m_heapIndex[index] == -1) {
+            HeapPush(index, CalculateKey(index));
+        }
+        else {
+            HeapUpdate(index, CalculateKey(index));
+        }
+    }
+    else if (m_heapIndex[index] != -1) {
+        HeapRemove(index);
+    }
+}
+
+// Neighbour with the lowest step cost plus g, -1 if there is none. Cost gets their sum.
+int DStarLite::GetBestSuccessor(int index, int& cost) const {
+    int neighbours[8];
+    int costs[8];
+    int neighbourCount = GetNeighbours(index, neighbours, costs);
+    int best = -1;
+    cost = DSTAR_INFINITY;
+    for (int i = 0; i < neighbourCount; i++) {
+        int candidate = AddCost(costs[i], m_g[neighbours[i]]);
+        if (candidate < cost) {
+            cost = candidate;
+            best = neighbours[i];
+        }
+    }
+    return best;
+}
+
+// Steps are symmetric, so these are both the successors and the predecessors. Walls have neither.
+int DStarLite::GetNeighbours(int index, int* neighbours, int* costs) const {
+    int x = index % m_width;
+    int y = index / m_width;
+    if (m_grid->IsBlocked(x, y)) {
+        return 0;
+    }
+    int directionCount = (m_diagonalMovement == DIAGONAL_NEVER) ? 4 : 8;
+    int neighbourCount = 0;
+    for (int direction = 0; direction < directionCount; direction++) {
+        int dx = g_directionX[direction];
+        int dy = g_directionY[direction];
+        if (m_grid->CanStep(x, y, dx, dy, m_diagonalMovement)) {
+            neighbours[neighbourCount] = (y + dy) * m_width + x + dx;
+            costs[neighbourCount] = (dx != 0 && dy != 0) ? DIAGONAL_COST : ORTHOGONAL_COST;
+            if (m_terrain) {
+                costs[neighbourCount] = m_terrain->GetStepCost(index, neighbours[neighbourCount], costs[neighbourCount]);
+            }
+            neighbourCount++;
+        }
+    }
+    return neighbourCount;
+}
+
+// Weights are never below 1, so the unweighted distance stays admissible through any terrain edit
+int DStarLite::GetH(int indexA, int indexB) const {
+    int dstX = std::abs(indexA % m_width - indexB % m_width);
+    int dstY = std::abs(indexA / m_width - indexB / m_width);
+    if (m_diagonalMovement == DIAGONAL_NEVER) {
+        return ORTHOGONAL_COST * (dstX + dstY);
+    }
+    return DIAGONAL_COST * std::min(dstX, dstY) + ORTHOGONAL_COST * std::abs(dstX - dstY);
+}
+
+void DStarLite::HeapPush(int index, Key key) {
+    m_keys[index] = key;
+    m_heapIndex[index] = (int)m_heap.size();
+    m_heap.push_back(index);
+    HeapSortUp(m_heapIndex[index]);
+}
+
+void DStarLite::HeapUpdate(int index, Key key) {
+    Key oldKey = m_keys[index];
+    m_keys[index] = key;
+    if (key < oldKey) {
+        HeapSortUp(m_heapIndex[index]);
+    }
+    else {
+        HeapSortDown(m_heapIndex[index]);
+    }
+}
+
+void DStarLite::HeapRemove(int index) {
+    int position = m_heapIndex[index];
+    int last = (int)m_heap.size() - 1;
+    if (position != last) {
+        HeapSwap(position, last);
+    }
+    m_heap.pop_back();
+    m_heapIndex[index] = -1;
+    if (position < (int)m_heap.size()) {
+        int moved = m_heap[position];
+        HeapSortUp(position);
+        HeapSortDown(m_heapIndex[moved]);
+    }
+}
+
+void DStarLite::HeapSortUp(int position) {
+    while (position > 0) {
+        int parent = (position - 1) / 2;
+        if (!(m_keys[m_heap[position]] < m_keys[m_heap[parent]])) {
+            break;
+        }
+        HeapSwap(position, parent);
+        position = parent;
+    }
+}
+
+void DStarLite::HeapSortDown(int position) {
+    int count = (int)m_heap.size();
+    while (true) {
+        int left = position * 2 + 1;
+        int right = left + 1;
+        int smallest = position;
+        if (left < count && m_keys[m_heap[left]] < m_keys[m_heap[smallest]]) {
+            smallest = left;
+        }
+        if (right < count && m_keys[m_heap[right]] < m_keys[m_heap[smallest]]) {
+            smallest = right;
+        }
+        if (smallest == position) {
+            break;
+        }
+        HeapSwap(position, smallest);
+        position = smallest;
+    }
+}
+
+void DStarLite::HeapSwap(int positionA, int positionB) {
+    std::swap(m_heap[positionA], m_heap[positionB]);
+    m_heapIndex[m_heap[positionA]] = positionA;
+    m_heapIndex[m_heap[positionB]] = positionB;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include "Pathfinding.h"
+
+#define DSTAR_INFINITY 0x3fffffff
+
+// D* Lite. Searches backwards from the target so that the whole search survives the start moving and
+// cells being toggled. After an edit only cells whose cost to the target actually changed are expanded
+// again, which for a single wall is usually a small fraction of a fresh search.
+struct DStarLite {
+    void Init(const ObstacleGrid& grid, int startX, int startY, int targetX, int targetY, DiagonalMovement diagonalMovement, const TerrainCosts* terrain = nullptr);
+    void Clear();
+    void MoveStart(int x, int y);
+    void UpdateCell(int x, int y);
+    bool ComputeShortestPath();
+    bool GetPath(std::vector<int>& path) const;
+    bool IsInitialized() const;
+    bool Matches(int targetX, int targetY, DiagonalMovement diagonalMovement) const;
+    int GetPathCost() const;
+    int GetExpansions() const;
+
+private:
+    struct Key {
+        int primary = DSTAR_INFINITY;
+        int secondary = DSTAR_INFINITY;
+        bool operator<(const Key& other) const {
+            return primary < other.primary || (primary == other.primary && secondary < other.secondary);
+        }
+    };
+
+    Key CalculateKey(int index) const;
+    void UpdateVertex(int index);
+    int GetBestSuccessor(int index, int& cost) const;
+    int GetNeighbours(int index, int* neighbours, int* costs) const;
+    int GetH(int indexA, int indexB) const;
+
+    // Indexed binary heap on Key, so queued cells can be re-keyed and removed
+    void HeapPush(int index, Key key);
+    void HeapUpdate(int index, Key key);
+    void HeapRemove(int index);
+    void HeapSortUp(int position);
+    void HeapSortDown(int position);
+    void HeapSwap(int positionA, int positionB);
+
+    const ObstacleGrid* m_grid = nullptr;
+    const TerrainCosts* m_terrain = nullptr;  // Read on every step, so weight edits must go through UpdateCell
+    DiagonalMovement m_diagonalMovement = DIAGONAL_NEVER;
+    int m_width = 0;
+    int m_height = 0;
+    int m_start = -1;
+    int m_target = -1;
+    int m_keyModifier = 0;              // km, grows by the heuristic distance each time the start moves
+    int m_expansions = 0;               // In the last ComputeShortestPath
+    std::vector<int> m_g;
+    std::vector<int> m_rhs;             // One step lookahead of g, the cell is consistent when they match
+    std::vector<Key> m_keys;
+    std::vector<int> m_heapIndex;       // -1 when not queued
+    std::vector<int> m_heap;
+};
@@ -0,0 +1,78 @@
+#include "FlowField.h"
+#include <queue>
+
+namespace {
+    const int g_directionX[8] = { 0, 1, 0, -1, 1, 1, -1, -1 };
+    const int g_directionY[8] = { -1, 0, 1, 0, -1, 1, 1, -1 };
+}
+
+int FlowField::GetDirectionX(int direction) {
+    return g_directionX[direction];
+}
+
+int FlowField::GetDirectionY(int direction) {
+    return g_directionY[direction];
+}
+
+bool FlowField::IsBuilt() const {
+    return !distances.empty();
+}
+
+int FlowField::GetDistance(int x, int y) const {
+    if (x < 0 || y < 0 || x >= width || y >= height) {
+        return FLOW_FIELD_UNREACHABLE;
+    }
+    return distances[y * width + x];
+}
+
+// Step to take from x, y to follow the cheapest path to the target, zero at the target or if there is none
+glm::ivec2 FlowField::GetDirection(int x, int y) const {
+    if (x < 0 || y < 0 || x >= width || y >= height || directions[y * width + x] == FLOW_FIELD_NO_DIRECTION) {
+        return glm::ivec2(0, 0);
+    }
+    int direction = directions[y * width + x];
+    return glm::ivec2(g_directionX[direction], g_directionY[direction]);
+}
+
+void FlowField::Build(const ObstacleGrid& grid, int targetX, int targetY, DiagonalMovement diagonalMovement, const TerrainCosts* terrain) {
+    width = grid.width;
+    height = grid.height;
+    this->targetX = targetX;
+    this->targetY = targetY;
+    this->diagonalMovement = diagonalMovement;
+    distances.assign(width * height, FLOW_FIELD_UNREACHABLE);
+    directions.assign(width * height, FLOW_FIELD_NO_DIRECTION);
+    if (targetX < 0 || targetY < 0 || targetX >= width || targetY >= height || grid.IsBlocked(targetX, targetY)) {
+        return;
+    }
+    int directionCount = (diagonalMovement == DIAGONAL_NEVER) ? 4 : 8;
+    std::priority_queue<std::pair<int, int>, std::vector<std::pair<int, int>>, std::greater<std::pair<int, int>>> queue;
+    distances[targetY * width + targetX] = 0;
+    queue.push({ 0, targetY * width + targetX });
+    while (!queue.empty()) {
+        auto [distance, index] = queue.top();
+        queue.pop();
+        if (distance > distances[index]) {
+            continue;
+        }
+        int x = index % width;
+        int y = index / width;
+        for (int direction = 0; direction < directionCount; direction++) {
+            int dx = g_directionX[direction];
+            int dy = g_directionY[direction];
+            // Steps are symmetric, so a step from the neighbour to here is legal exactly when this one is
+            if (!grid.CanStep(x, y, dx, dy, diagonalMovement)) {
+                continue;
+            }
+            int neighbour = (y + dy) * width + x + dx;
+            int stepCost = (dx != 0 && dy != 0) ? DIAGONAL_COST : ORTHOGONAL_COST;
+            int neighbourDistance = distance + (terrain ? terrain->GetStepCost(index, neighbour, stepCost) : stepCost);
+            if (neighbourDistance < distances[neighbour]) {
+                distances[neighbour] = neighbourDistance;
+                // The neighbour walks back the way we came
+                directions[neighbour] = (uint8_t)(direction ^ 2);
+                queue.push({ neighbourDistance, neighbour });
+            }
+        }
+    }
+}
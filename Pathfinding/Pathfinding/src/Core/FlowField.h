@@ -0,0 +1,25 @@
+#pragma once
+#include "Pathfinding.h"
+
+#define FLOW_FIELD_UNREACHABLE INT_MAX
+#define FLOW_FIELD_NO_DIRECTION 255
+
+// Distance to one target from every cell, built with a single Dijkstra pass out from the target using
+// the same step costs as AStar. Any number of agents can then read the next step or remaining cost in O(1).
+struct FlowField {
+    int width = 0;
+    int height = 0;
+    int targetX = -1;
+    int targetY = -1;
+    DiagonalMovement diagonalMovement = DIAGONAL_NEVER;
+    std::vector<int> distances;     // FLOW_FIELD_UNREACHABLE for walls and cells cut off from the target
+    std::vector<uint8_t> directions; // Index into the direction table, FLOW_FIELD_NO_DIRECTION at the target and unreachable cells
+
+    void Build(const ObstacleGrid& grid, int targetX, int targetY, DiagonalMovement diagonalMovement, const TerrainCosts* terrain = nullptr);
+    bool IsBuilt() const;
+    int GetDistance(int x, int y) const;
+    glm::ivec2 GetDirection(int x, int y) const;
+
+    static int GetDirectionX(int direction);
+    static int GetDirectionY(int direction);
+};
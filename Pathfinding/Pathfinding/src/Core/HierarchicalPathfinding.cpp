@@ -0,0 +1,417 @@
+#include "HierarchicalPathfinding.h"
+#include <algorithm>
+#include <climits>
+#include <queue>
+
+void HierarchicalPath::Clear() {
+    waypoints.clear();
+    cells.clear();
+    refinedSegments = 0;
+    searched = false;
+    found = false;
+}
+
+bool HierarchicalPath::IsRefined() const {
+    return found && refinedSegments + 1 >= (int)waypoints.size();
+}
+
+void HierarchicalPathfinder::Build(const ObstacleGrid& grid, DiagonalMovement diagonalMovement, const TerrainCosts* terrain) {
+    m_grid = &grid;
+    m_terrain = terrain;
+    m_diagonalMovement = diagonalMovement;
+    m_clustersX = (grid.width + HPA_CLUSTER_SIZE - 1) / HPA_CLUSTER_SIZE;
+    m_clustersY = (grid.height + HPA_CLUSTER_SIZE - 1) / HPA_CLUSTER_SIZE;
+    int clusterCount = m_clustersX * m_clustersY;
+    m_nodes.clear();
+    m_freeNodes.clear();
+    m_clusterNodes.assign(clusterCount, std::vector<int>());
+    m_verticalBorderNodes.assign(clusterCount, std::vector<int>());
+    m_horizontalBorderNodes.assign(clusterCount, std::vector<int>());
+    for (int cluster = 0; cluster < clusterCount; cluster++) {
+        BuildBorder(cluster, true);
+        BuildBorder(cluster, false);
+    }
+    for (int cluster = 0; cluster < clusterCount; cluster++) {
+        BuildIntraEdges(cluster);
+    }
+}
+
+// Only the cluster holding the cell changes internally. Its entrances only change if the cell sits on
+// a border, in which case the cluster on the other side needs its intra edges redone too.
+void HierarchicalPathfinder::UpdateCell(const ObstacleGrid& grid, int x, int y) {
+    if (m_grid != &grid || (grid.width + HPA_CLUSTER_SIZE - 1) / HPA_CLUSTER_SIZE != m_clustersX || (grid.height + HPA_CLUSTER_SIZE - 1) / HPA_CLUSTER_SIZE != m_clustersY) {
+        Build(grid, m_diagonalMovement, m_terrain);
+        return;
+    }
+    int cluster = GetClusterIndex(x, y);
+    int clusterX = cluster % m_clustersX;
+    int clusterY = cluster / m_clustersX;
+    glm::ivec4 bounds = GetClusterBounds(cluster);
+    std::vector<int> affectedClusters = { cluster };
+    if (x == bounds.x && clusterX > 0) {
+        ClearBorder(cluster - 1, true);
+        BuildBorder(cluster - 1, true);
+        affectedClusters.push_back(cluster - 1);
+    }
+    if (x == bounds.z && clusterX + 1 < m_clustersX) {
+        ClearBorder(cluster, true);
+        BuildBorder(cluster, true);
+        affectedClusters.push_back(cluster + 1);
+    }
+    if (y == bounds.y && clusterY > 0) {
+        ClearBorder(cluster - m_clustersX, false);
+        BuildBorder(cluster - m_clustersX, false);
+        affectedClusters.push_back(cluster - m_clustersX);
+    }
+    if (y == bounds.w && clusterY + 1 < m_clustersY) {
+        ClearBorder(cluster, false);
+        BuildBorder(cluster, false);
+        affectedClusters.push_back(cluster + m_clustersX);
+    }
+    for (int affectedCluster : affectedClusters) {
+        BuildIntraEdges(affectedCluster);
+    }
+}
+
+bool HierarchicalPathfinder::FindAbstractPath(int startX, int startY, int targetX, int targetY, HierarchicalPath& path) {
+    path.Clear();
+    path.searched = true;
+    if (!m_grid || m_grid->IsBlocked(startX, startY) || m_grid->IsBlocked(targetX, targetY)) {
+        return false;
+    }
+    int startCluster = GetClusterIndex(startX, startY);
+    int targetCluster = GetClusterIndex(targetX, targetY);
+    glm::ivec4 startBounds = GetClusterBounds(startCluster);
+    glm::ivec4 targetBounds = GetClusterBounds(targetCluster);
+    int startBoundsWidth = startBounds.z - startBounds.x + 1;
+    int targetBoundsWidth = targetBounds.z - targetBounds.x + 1;
+
+    // Start and target are linked into the graph for this query only
+    std::vector<int> startDistances;
+    std::vector<int> targetDistances;
+    FindClusterDistances(startX, startY, startCluster, startDistances);
+    FindClusterDistances(targetX, targetY, targetCluster, targetDistances);
+    int startNode = (int)m_nodes.size();
+    int targetNode = startNode + 1;
+
+    auto getCell = [&](int node) {
+        if (node == startNode) {
+            return glm::ivec2(startX, startY);
+        }
+        else if (node == targetNode) {
+            return glm::ivec2(targetX, targetY);
+        }
+        return glm::ivec2(m_nodes[node].x, m_nodes[node].y);
+    };
+    int heuristicScale = m_terrain ? m_terrain->GetMinWeight() : 1;
+    auto getH = [&](int node) {
+        glm::ivec2 cell = getCell(node);
+        int dstX = std::abs(cell.x - targetX);
+        int dstY = std::abs(cell.y - targetY);
+        if (m_diagonalMovement == DIAGONAL_NEVER) {
+            return ORTHOGONAL_COST * (dstX + dstY) * heuristicScale;
+        }
+        return (DIAGONAL_COST * std::min(dstX, dstY) + ORTHOGONAL_COST * std::abs(dstX - dstY)) * heuristicScale;
+    };
+
+    if (m_searchNodes.width != startNode + 2) {
+        m_searchNodes.Resize(startNode + 2, 1);
+    }
+    m_openList.Init(&m_searchNodes, m_openListType);
+    m_searchNodes.NewGeneration();
+
+    auto relax = [&](int from, int to, int cost) {
+        m_searchNodes.Touch(to);
+        if (m_searchNodes.state[to] == NODE_CLOSED) {
+            return;
+        }
+        int newG = m_searchNodes.g[from] + cost;
+        if (m_searchNodes.state[to] == NODE_UNVISITED) {
+            m_searchNodes.g[to] = newG;
+            m_searchNodes.f[to] = newG + getH(to);
+            m_searchNodes.parent[to] = from;
+            m_searchNodes.state[to] = NODE_OPEN;
+            m_openList.AddItem(to);
+        }
+        else if (newG < m_searchNodes.g[to]) {
+            m_searchNodes.g[to] = newG;
+            m_searchNodes.f[to] = newG + getH(to);
+            m_searchNodes.parent[to] = from;
+            m_openList.Update(to);
+        }
+    };
+
+    m_searchNodes.Touch(startNode);
+    m_searchNodes.g[startNode] = 0;
+    m_searchNodes.f[startNode] = getH(startNode);
+    m_searchNodes.state[startNode] = NODE_OPEN;
+    m_openList.AddItem(startNode);
+    bool found = false;
+    while (!m_openList.IsEmpty()) {
+        int current = m_openList.RemoveFirst();
+        m_searchNodes.state[current] = NODE_CLOSED;
+        if (current == targetNode) {
+            found = true;
+            break;
+        }
+        if (current == startNode) {
+            for (int node : m_clusterNodes[startCluster]) {
+                int distance = startDistances[(m_nodes[node].y - startBounds.y) * startBoundsWidth + m_nodes[node].x - startBounds.x];
+                if (distance != INT_MAX) {
+                    relax(current, node, distance);
+                }
+            }
+            if (startCluster == targetCluster) {
+                int distance = startDistances[(targetY - startBounds.y) * startBoundsWidth + targetX - startBounds.x];
+                if (distance != INT_MAX) {
+                    relax(current, targetNode, distance);
+                }
+            }
+            continue;
+        }
+        for (HierarchicalEdge& edge : m_nodes[current].edges) {
+            relax(current, edge.to, edge.cost);
+        }
+        if (m_nodes[current].cluster == targetCluster) {
+            int distance = targetDistances[(m_nodes[current].y - targetBounds.y) * targetBoundsWidth + m_nodes[current].x - targetBounds.x];
+            if (distance != INT_MAX) {
+                relax(current, targetNode, distance);
+            }
+        }
+    }
+    if (!found) {
+        return false;
+    }
+    int node = targetNode;
+    while (node != -1) {
+        glm::ivec2 cell = getCell(node);
+        // Transitions on a cluster corner can show up twice in a row
+        if (path.waypoints.empty() || path.waypoints.back() != cell) {
+            path.waypoints.push_back(cell);
+        }
+        node = m_searchNodes.parent[node];
+    }
+    std::reverse(path.waypoints.begin(), path.waypoints.end());
+    path.found = true;
+    return true;
+}
+
+// Turns the next abstract edge into cells. Returns false once the whole path is refined.
+bool HierarchicalPathfinder::RefineNextSegment(HierarchicalPath& path) {
+    if (!path.found || path.IsRefined()) {
+        return false;
+    }
+    glm::ivec2 from = path.waypoints[path.refinedSegments];
+    glm::ivec2 to = path.waypoints[path.refinedSegments + 1];
+    int cluster = GetClusterIndex(from.x, from.y);
+    if (cluster != GetClusterIndex(to.x, to.y)) {
+        // Inter-cluster edges are always a single orthogonal step across the border
+        path.cells.push_back(to.y * m_grid->width + to.x);
+    }
+    else {
+        MapView mapView;
+        mapView.grid = m_grid;
+        mapView.terrain = (m_terrain && !m_terrain->IsUniform()) ? m_terrain : nullptr;
+        SearchConfig config;
+        config.diagonalMovement = m_diagonalMovement;
+        config.openList = m_openListType;
+        m_refiner.InitBoundedSearch(mapView, config, from.x, from.y, to.x, to.y, GetClusterBounds(cluster));
+        m_refiner.FindPath();
+        if (!m_refiner.GridPathFound()) {
+            path.found = false;
+            return false;
+        }
+        NodeStore& nodes = m_refiner.GetNodes();
+        for (int index : m_refiner.GetPath()) {
+            path.cells.push_back(nodes.GetY(index) * m_grid->width + nodes.GetX(index));
+        }
+    }
+    path.refinedSegments++;
+    return true;
+}
+
+void HierarchicalPathfinder::SetOpenListType(OpenListType type) {
+    m_openListType = type;
+}
+
+int HierarchicalPathfinder::GetNodeCount() const {
+    return (int)(m_nodes.size() - m_freeNodes.size());
+}
+
+const std::vector<HierarchicalNode>& HierarchicalPathfinder::GetNodes() const {
+    return m_nodes;
+}
+
+int HierarchicalPathfinder::GetClusterIndex(int x, int y) const {
+    return (y / HPA_CLUSTER_SIZE) * m_clustersX + x / HPA_CLUSTER_SIZE;
+}
+
+glm::ivec4 HierarchicalPathfinder::GetClusterBounds(int cluster) const {
+    int minX = (cluster % m_clustersX) * HPA_CLUSTER_SIZE;
+    int minY = (cluster / m_clustersX) * HPA_CLUSTER_SIZE;
+    int maxX = std::min(minX + HPA_CLUSTER_SIZE, m_grid->width) - 1;
+    int maxY = std::min(minY + HPA_CLUSTER_SIZE, m_grid->height) - 1;
+    return glm::ivec4(minX, minY, maxX, maxY);
+}
+
+// Finds the entrances on the east (vertical) or south border of a cluster and adds a transition pair for each
+void HierarchicalPathfinder::BuildBorder(int cluster, bool vertical) {
+    int clusterX = cluster % m_clustersX;
+    int clusterY = cluster / m_clustersX;
+    if ((vertical && clusterX + 1 >= m_clustersX) || (!vertical && clusterY + 1 >= m_clustersY)) {
+        return;
+    }
+    glm::ivec4 bounds = GetClusterBounds(cluster);
+    std::vector<int>& borderNodes = vertical ? m_verticalBorderNodes[cluster] : m_horizontalBorderNodes[cluster];
+    int stepX = vertical ? 1 : 0;
+    int stepY = vertical ? 0 : 1;
+    int begin = vertical ? bounds.y : bounds.x;
+    int end = vertical ? bounds.w : bounds.z;
+
+    auto addTransition = [&](int i) {
+        int x = vertical ? bounds.z : i;
+        int y = vertical ? i : bounds.w;
+        int inside = AddNode(x, y);
+        int outside = AddNode(x + stepX, y + stepY);
+        int cost = GetStepCost(x, y, stepX, stepY);
+        m_nodes[inside].edges.push_back({ outside, cost });
+        m_nodes[outside].edges.push_back({ inside, cost });
+        borderNodes.push_back(inside);
+        borderNodes.push_back(outside);
+    };
+    int runStart = -1;
+    for (int i = begin; i <= end + 1; i++) {
+        int x = vertical ? bounds.z : i;
+        int y = vertical ? i : bounds.w;
+        bool open = (i <= end) && !m_grid->IsBlocked(x, y) && !m_grid->IsBlocked(x + stepX, y + stepY);
+        if (open && runStart == -1) {
+            runStart = i;
+        }
+        else if (!open && runStart != -1) {
+            int runEnd = i - 1;
+            if (runEnd - runStart + 1 < HPA_MAX_ENTRANCE_WIDTH) {
+                addTransition((runStart + runEnd) / 2);
+            }
+            else {
+                addTransition(runStart);
+                addTransition(runEnd);
+            }
+            runStart = -1;
+        }
+    }
+}
+
+void HierarchicalPathfinder::ClearBorder(int cluster, bool vertical) {
+    std::vector<int>& borderNodes = vertical ? m_verticalBorderNodes[cluster] : m_horizontalBorderNodes[cluster];
+    for (int node : borderNodes) {
+        RemoveNode(node);
+    }
+    borderNodes.clear();
+}
+
+void HierarchicalPathfinder::BuildIntraEdges(int cluster) {
+    std::vector<int>& clusterNodes = m_clusterNodes[cluster];
+    for (int node : clusterNodes) {
+        std::vector<HierarchicalEdge>& edges = m_nodes[node].edges;
+        edges.erase(std::remove_if(edges.begin(), edges.end(), [&](const HierarchicalEdge& edge) {
+            return m_nodes[edge.to].cluster == cluster;
+        }), edges.end());
+    }
+    glm::ivec4 bounds = GetClusterBounds(cluster);
+    int boundsWidth = bounds.z - bounds.x + 1;
+    std::vector<int> distances;
+    for (int node : clusterNodes) {
+        FindClusterDistances(m_nodes[node].x, m_nodes[node].y, cluster, distances);
+        for (int other : clusterNodes) {
+            if (other == node) {
+                continue;
+            }
+            int distance = distances[(m_nodes[other].y - bounds.y) * boundsWidth + m_nodes[other].x - bounds.x];
+            if (distance != INT_MAX) {
+                m_nodes[node].edges.push_back({ other, distance });
+            }
+        }
+    }
+}
+
+int HierarchicalPathfinder::AddNode(int x, int y) {
+    int node;
+    if (!m_freeNodes.empty()) {
+        node = m_freeNodes.back();
+        m_freeNodes.pop_back();
+    }
+    else {
+        node = (int)m_nodes.size();
+        m_nodes.emplace_back();
+    }
+    m_nodes[node].x = x;
+    m_nodes[node].y = y;
+    m_nodes[node].cluster = GetClusterIndex(x, y);
+    m_nodes[node].active = true;
+    m_nodes[node].edges.clear();
+    m_clusterNodes[m_nodes[node].cluster].push_back(node);
+    return node;
+}
+
+void HierarchicalPathfinder::RemoveNode(int node) {
+    // Edges are symmetric, so every node that links here is one of our own edge targets
+    for (HierarchicalEdge& edge : m_nodes[node].edges) {
+        std::vector<HierarchicalEdge>& otherEdges = m_nodes[edge.to].edges;
+        otherEdges.erase(std::remove_if(otherEdges.begin(), otherEdges.end(), [node](const HierarchicalEdge& otherEdge) {
+            return otherEdge.to == node;
+        }), otherEdges.end());
+    }
+    std::vector<int>& clusterNodes = m_clusterNodes[m_nodes[node].cluster];
+    clusterNodes.erase(std::remove(clusterNodes.begin(), clusterNodes.end(), node), clusterNodes.end());
+    m_nodes[node].edges.clear();
+    m_nodes[node].active = false;
+    m_nodes[node].cluster = -1;
+    m_freeNodes.push_back(node);
+}
+
+// Cost of one step from x, y by dx, dy, weighted by terrain when there is any
+int HierarchicalPathfinder::GetStepCost(int x, int y, int dx, int dy) const {
+    int cost = (dx != 0 && dy != 0) ? DIAGONAL_COST : ORTHOGONAL_COST;
+    if (m_terrain) {
+        cost = m_terrain->GetStepCost(y * m_grid->width + x, (y + dy) * m_grid->width + x + dx, cost);
+    }
+    return cost;
+}
+
+// Dijkstra from x, y that never leaves the cluster. Unreachable cells are left at INT_MAX.
+void HierarchicalPathfinder::FindClusterDistances(int x, int y, int cluster, std::vector<int>& distances) {
+    glm::ivec4 bounds = GetClusterBounds(cluster);
+    int boundsWidth = bounds.z - bounds.x + 1;
+    int boundsHeight = bounds.w - bounds.y + 1;
+    distances.assign(boundsWidth * boundsHeight, INT_MAX);
+    std::priority_queue<std::pair<int, int>, std::vector<std::pair<int, int>>, std::greater<std::pair<int, int>>> queue;
+    distances[(y - bounds.y) * boundsWidth + x - bounds.x] = 0;
+    queue.push({ 0, (y - bounds.y) * boundsWidth + x - bounds.x });
+    while (!queue.empty()) {
+        auto [distance, local] = queue.top();
+        queue.pop();
+        if (distance > distances[local]) {
+            continue;
+        }
+        int cellX = bounds.x + local % boundsWidth;
+        int cellY = bounds.y + local / boundsWidth;
+        for (int dy = -1; dy <= 1; dy++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                int nextX = cellX + dx;
+                int nextY = cellY + dy;
+                if ((dx == 0 && dy == 0) || nextX < bounds.x || nextY < bounds.y || nextX > bounds.z || nextY > bounds.w) {
+                    continue;
+                }
+                if (!m_grid->CanStep(cellX, cellY, dx, dy, m_diagonalMovement)) {
+                    continue;
+                }
+                int nextLocal = (nextY - bounds.y) * boundsWidth + nextX - bounds.x;
+                int nextDistance = distance + GetStepCost(cellX, cellY, dx, dy);
+                if (nextDistance < distances[nextLocal]) {
+                    distances[nextLocal] = nextDistance;
+                    queue.push({ nextDistance, nextLocal });
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include "Pathfinding.h"
+
+#define HPA_CLUSTER_SIZE 10
+#define HPA_MAX_ENTRANCE_WIDTH 6 // Entrances at least this wide get a transition at each end instead of one in the middle
+
+struct HierarchicalEdge {
+    int to = -1;
+    int cost = 0;
+};
+
+// A cell on a cluster border that the abstract graph can route through
+struct HierarchicalNode {
+    int x = 0;
+    int y = 0;
+    int cluster = -1;
+    bool active = false;
+    std::vector<HierarchicalEdge> edges;
+};
+
+struct HierarchicalPath {
+    std::vector<glm::ivec2> waypoints;  // Start, abstract nodes, target
+    std::vector<int> cells;             // Refined cell indices excluding the start, grows one segment at a time
+    int refinedSegments = 0;
+    bool searched = false;
+    bool found = false;
+    void Clear();
+    bool IsRefined() const;
+};
+
+// HPA*. The grid is cut into clusters, each border gets transitions where both sides are open, and the
+// cost between every pair of transitions in a cluster is cached. Queries plan on that small graph first
+// and refine it into cells one segment at a time with a bounded AStar.
+struct HierarchicalPathfinder {
+    void Build(const ObstacleGrid& grid, DiagonalMovement diagonalMovement, const TerrainCosts* terrain = nullptr);
+    void UpdateCell(const ObstacleGrid& grid, int x, int y);
+    bool FindAbstractPath(int startX, int startY, int targetX, int targetY, HierarchicalPath& path);
+    bool RefineNextSegment(HierarchicalPath& path);
+    void SetOpenListType(OpenListType type);
+    int GetNodeCount() const;
+    const std::vector<HierarchicalNode>& GetNodes() const;
+
+private:
+    int GetClusterIndex(int x, int y) const;
+    glm::ivec4 GetClusterBounds(int cluster) const;
+    void BuildBorder(int cluster, bool vertical);
+    void ClearBorder(int cluster, bool vertical);
+    void BuildIntraEdges(int cluster);
+    int AddNode(int x, int y);
+    void RemoveNode(int node);
+    void FindClusterDistances(int x, int y, int cluster, std::vector<int>& distances);
+    int GetStepCost(int x, int y, int dx, int dy) const;
+
+    const ObstacleGrid* m_grid = nullptr;
+    const TerrainCosts* m_terrain = nullptr;
+    DiagonalMovement m_diagonalMovement = DIAGONAL_NEVER;
+    int m_clustersX = 0;
+    int m_clustersY = 0;
+    std::vector<HierarchicalNode> m_nodes;
+    std::vector<int> m_freeNodes;
+    std::vector<std::vector<int>> m_clusterNodes;
+    std::vector<std::vector<int>> m_verticalBorderNodes;    // Border between a cluster and its east neighbour
+    std::vector<std::vector<int>> m_horizontalBorderNodes;  // Border between a cluster and its south neighbour
+    NodeStore m_searchNodes;
+    OpenListType m_openListType = OPEN_LIST_QUATERNARY_HEAP;
+    OpenList m_openList;
+    AStar m_refiner;
+};
@@ -0,0 +1,189 @@
+#include "JumpDistances.h"
+#include <algorithm>
+
+namespace {
+    const int g_directionX[JUMP_DIRECTION_COUNT] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+    const int g_directionY[JUMP_DIRECTION_COUNT] = { -1, -1, 0, 1, 1, 1, 0, -1 };
+
+    // Straight directions come first because the vertical and diagonal rules read them
+    const int g_straightDirections[4] = { JUMP_EAST, JUMP_WEST, JUMP_NORTH, JUMP_SOUTH };
+    const int g_diagonalDirections[4] = { JUMP_NORTH_EAST, JUMP_SOUTH_EAST, JUMP_SOUTH_WEST, JUMP_NORTH_WEST };
+}
+
+int JumpDistanceTable::GetDirection(int dx, int dy) {
+    for (int i = 0; i < JUMP_DIRECTION_COUNT; i++) {
+        if (g_directionX[i] == dx && g_directionY[i] == dy) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int JumpDistanceTable::GetDirectionX(int direction) {
+    return g_directionX[direction];
+}
+
+int JumpDistanceTable::GetDirectionY(int direction) {
+    return g_directionY[direction];
+}
+
+bool JumpDistanceTable::IsBuilt() const {
+    return !distances.empty();
+}
+
+void JumpDistanceTable::Build(const ObstacleGrid& grid, DiagonalMovement diagonalMovement) {
+    this->diagonalMovement = diagonalMovement;
+    width = grid.width;
+    height = grid.height;
+    distances.assign(width * height * JUMP_DIRECTION_COUNT, 0);
+
+    auto buildDirection = [&](int direction) {
+        // Visit cells furthest along the direction first, so the next cell is always ready
+        int dx = g_directionX[direction];
+        int dy = g_directionY[direction];
+        for (int i = 0; i < height; i++) {
+            int y = (dy > 0) ? height - 1 - i : i;
+            for (int j = 0; j < width; j++) {
+                int x = (dx > 0) ? width - 1 - j : j;
+                SetDistance(x, y, direction, ComputeDistance(grid, x, y, direction));
+            }
+        }
+    };
+    for (int direction : g_straightDirections) {
+        buildDirection(direction);
+    }
+    if (diagonalMovement != DIAGONAL_NEVER) {
+        for (int direction : g_diagonalDirections) {
+            buildDirection(direction);
+        }
+    }
+}
+
+void JumpDistanceTable::UpdateCell(const ObstacleGrid& grid, int x, int y) {
+    if (!IsBuilt() || grid.width != width || grid.height != height) {
+        Build(grid, diagonalMovement);
+        return;
+    }
+    // A cell's distance depends on whether the next cell is open and on the 3x3 block around it,
+    // so only cells within two steps of the edit see their own inputs change. Everything further
+    // away is reached by propagating backwards along each direction until the values stop changing.
+    std::vector<glm::ivec2> block;
+    for (int offsetY = -2; offsetY <= 2; offsetY++) {
+        for (int offsetX = -2; offsetX <= 2; offsetX++) {
+            if (x + offsetX >= 0 && x + offsetX < width && y + offsetY >= 0 && y + offsetY < height) {
+                block.push_back(glm::ivec2(x + offsetX, y + offsetY));
+            }
+        }
+    }
+    // Cells whose straight distances flipped between jump point and wall
+    std::vector<glm::ivec2> changedHorizontal;
+    std::vector<glm::ivec2> changedStraight;
+
+    std::vector<glm::ivec2> seeds = block;
+    UpdateDirection(grid, JUMP_EAST, seeds, &changedHorizontal);
+    seeds = block;
+    UpdateDirection(grid, JUMP_WEST, seeds, &changedHorizontal);
+    changedStraight = changedHorizontal;
+
+    for (int direction : { JUMP_NORTH, JUMP_SOUTH }) {
+        seeds = block;
+        if (diagonalMovement == DIAGONAL_NEVER) {
+            // Without diagonals a vertical scan also stops wherever a horizontal scan finds something
+            for (glm::ivec2& cell : changedHorizontal) {
+                seeds.push_back(glm::ivec2(cell.x, cell.y - g_directionY[direction]));
+            }
+        }
+        UpdateDirection(grid, direction, seeds, &changedStraight);
+    }
+    if (diagonalMovement == DIAGONAL_NEVER) {
+        return;
+    }
+    for (int direction : g_diagonalDirections) {
+        seeds = block;
+        for (glm::ivec2& cell : changedStraight) {
+            seeds.push_back(glm::ivec2(cell.x - g_directionX[direction], cell.y - g_directionY[direction]));
+        }
+        UpdateDirection(grid, direction, seeds, nullptr);
+    }
+}
+
+void JumpDistanceTable::UpdateDirection(const ObstacleGrid& grid, int direction, std::vector<glm::ivec2>& seeds, std::vector<glm::ivec2>* changedJumpPoints) {
+    int dx = g_directionX[direction];
+    int dy = g_directionY[direction];
+    // Furthest along the direction first, same order as a full build
+    std::sort(seeds.begin(), seeds.end(), [dx, dy](const glm::ivec2& a, const glm::ivec2& b) {
+        return a.x * dx + a.y * dy > b.x * dx + b.y * dy;
+    });
+    for (glm::ivec2& seed : seeds) {
+        int x = seed.x;
+        int y = seed.y;
+        while (x >= 0 && y >= 0 && x < width && y < height) {
+            int oldDistance = GetDistance(x, y, direction);
+            int newDistance = ComputeDistance(grid, x, y, direction);
+            if (newDistance == oldDistance) {
+                break;
+            }
+            SetDistance(x, y, direction, newDistance);
+            if (changedJumpPoints && (oldDistance > 0) != (newDistance > 0)) {
+                changedJumpPoints->push_back(glm::ivec2(x, y));
+            }
+            x -= dx;
+            y -= dy;
+        }
+    }
+}
+
+int JumpDistanceTable::ComputeDistance(const ObstacleGrid& grid, int x, int y, int direction) const {
+    if (!IsWalkable(grid, x, y) || !CanStep(grid, x, y, direction)) {
+        return 0;
+    }
+    int nextX = x + g_directionX[direction];
+    int nextY = y + g_directionY[direction];
+    if (IsJumpPoint(grid, nextX, nextY, direction)) {
+        return 1;
+    }
+    int nextDistance = GetDistance(nextX, nextY, direction);
+    return (nextDistance > 0) ? nextDistance + 1 : nextDistance - 1;
+}
+
+void JumpDistanceTable::SetDistance(int x, int y, int direction, int distance) {
+    distances[(y * width + x) * JUMP_DIRECTION_COUNT + direction] = (int16_t)distance;
+}
+
+bool JumpDistanceTable::IsWalkable(const ObstacleGrid& grid, int x, int y) const {
+    return !grid.IsBlocked(x, y);
+}
+
+bool JumpDistanceTable::CanStep(const ObstacleGrid& grid, int x, int y, int direction) const {
+    return grid.CanStep(x, y, g_directionX[direction], g_directionY[direction], diagonalMovement);
+}
+
+// Same rules as AStar::Jump, minus the destination check which JPS+ does at query time
+bool JumpDistanceTable::IsJumpPoint(const ObstacleGrid& grid, int x, int y, int direction) const {
+    int dx = g_directionX[direction];
+    int dy = g_directionY[direction];
+    if (dx != 0 && dy != 0) {
+        if (diagonalMovement == DIAGONAL_CORNER_CUTTING) {
+            if ((IsWalkable(grid, x - dx, y + dy) && !IsWalkable(grid, x - dx, y)) || (IsWalkable(grid, x + dx, y - dy) && !IsWalkable(grid, x, y - dy))) {
+                return true;
+            }
+        }
+        return GetDistance(x, y, GetDirection(dx, 0)) > 0 || GetDistance(x, y, GetDirection(0, dy)) > 0;
+    }
+    if (diagonalMovement == DIAGONAL_CORNER_CUTTING) {
+        if (dx != 0) {
+            return (IsWalkable(grid, x + dx, y - 1) && !IsWalkable(grid, x, y - 1)) || (IsWalkable(grid, x + dx, y + 1) && !IsWalkable(grid, x, y + 1));
+        }
+        return (IsWalkable(grid, x - 1, y + dy) && !IsWalkable(grid, x - 1, y)) || (IsWalkable(grid, x + 1, y + dy) && !IsWalkable(grid, x + 1, y));
+    }
+    if (dx != 0) {
+        return (IsWalkable(grid, x, y - 1) && !IsWalkable(grid, x - dx, y - 1)) || (IsWalkable(grid, x, y + 1) && !IsWalkable(grid, x - dx, y + 1));
+    }
+    if ((IsWalkable(grid, x - 1, y) && !IsWalkable(grid, x - 1, y - dy)) || (IsWalkable(grid, x + 1, y) && !IsWalkable(grid, x + 1, y - dy))) {
+        return true;
+    }
+    if (diagonalMovement == DIAGONAL_NEVER) {
+        return GetDistance(x, y, JUMP_EAST) > 0 || GetDistance(x, y, JUMP_WEST) > 0;
+    }
+    return false;
+}
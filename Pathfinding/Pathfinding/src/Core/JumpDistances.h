@@ -0,0 +1,43 @@
+#pragma once
+#include "Pathfinding.h"
+
+enum JumpDirection {
+    JUMP_NORTH = 0,
+    JUMP_NORTH_EAST,
+    JUMP_EAST,
+    JUMP_SOUTH_EAST,
+    JUMP_SOUTH,
+    JUMP_SOUTH_WEST,
+    JUMP_WEST,
+    JUMP_NORTH_WEST,
+    JUMP_DIRECTION_COUNT
+};
+
+// JPS+ preprocessing. For every cell and direction, the number of steps to the next jump point (positive)
+// or the negated number of steps that can be taken before hitting a wall (zero or negative).
+struct JumpDistanceTable {
+    int width = 0;
+    int height = 0;
+    DiagonalMovement diagonalMovement = DIAGONAL_NEVER;
+    std::vector<int16_t> distances; // JUMP_DIRECTION_COUNT entries per cell
+
+    void Build(const ObstacleGrid& grid, DiagonalMovement diagonalMovement);
+    void UpdateCell(const ObstacleGrid& grid, int x, int y);
+    bool IsBuilt() const;
+
+    int GetDistance(int x, int y, int direction) const {
+        return distances[(y * width + x) * JUMP_DIRECTION_COUNT + direction];
+    }
+
+    static int GetDirection(int dx, int dy);
+    static int GetDirectionX(int direction);
+    static int GetDirectionY(int direction);
+
+private:
+    bool IsWalkable(const ObstacleGrid& grid, int x, int y) const;
+    bool CanStep(const ObstacleGrid& grid, int x, int y, int direction) const;
+    bool IsJumpPoint(const ObstacleGrid& grid, int x, int y, int direction) const;
+    int ComputeDistance(const ObstacleGrid& grid, int x, int y, int direction) const;
+    void SetDistance(int x, int y, int direction, int distance);
+    void UpdateDirection(const ObstacleGrid& grid, int direction, std::vector<glm::ivec2>& seeds, std::vector<glm::ivec2>* changedJumpPoints);
+};
@@ -0,0 +1,133 @@
+#include "Landmarks.h"
+#include "FlowField.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace {
+    template <typename T>
+    int GetTableLowerBound(const T* distancesA, const T* distancesB, int landmarkCount, T unreachable) {
+        int bound = 0;
+        for (int i = 0; i < landmarkCount; i++) {
+            // A landmark that can't reach one of them says nothing about the other
+            if (distancesA[i] == unreachable || distancesB[i] == unreachable) {
+                continue;
+            }
+            bound = std::max(bound, std::abs((int)distancesA[i] - (int)distancesB[i]));
+        }
+        return bound;
+    }
+}
+
+// Runs one Dijkstra per landmark, spread over every core
+void LandmarkTable::Build(const ObstacleGrid& grid, DiagonalMovement diagonalMovement, int landmarkCount, const TerrainCosts* terrain) {
+    width = grid.width;
+    height = grid.height;
+    this->diagonalMovement = diagonalMovement;
+    distances16.clear();
+    distances32.clear();
+    PlaceLandmarks(grid, landmarkCount);
+    this->landmarkCount = (int)landmarks.size();
+    if (landmarks.empty()) {
+        return;
+    }
+
+    std::vector<FlowField> fields(landmarks.size());
+    std::atomic<int> nextLandmark = 0;
+    auto worker = [&]() {
+        for (int i = nextLandmark++; i < (int)landmarks.size(); i = nextLandmark++) {
+            fields[i].Build(grid, landmarks[i].x, landmarks[i].y, diagonalMovement, terrain);
+        }
+    };
+    int threadCount = std::min((int)landmarks.size(), std::max(1, (int)std::thread::hardware_concurrency()));
+    std::vector<std::thread> threads;
+    for (int i = 1; i < threadCount; i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    int maxDistance = 0;
+    for (const FlowField& field : fields) {
+        for (int distance : field.distances) {
+            if (distance != FLOW_FIELD_UNREACHABLE) {
+                maxDistance = std::max(maxDistance, distance);
+            }
+        }
+    }
+    int cellCount = width * height;
+    if (maxDistance < UINT16_MAX) {
+        distances16.resize(cellCount * this->landmarkCount);
+        for (int cell = 0; cell < cellCount; cell++) {
+            for (int i = 0; i < this->landmarkCount; i++) {
+                int distance = fields[i].distances[cell];
+                distances16[cell * this->landmarkCount + i] = (distance == FLOW_FIELD_UNREACHABLE) ? UINT16_MAX : (uint16_t)distance;
+            }
+        }
+    }
+    else {
+        distances32.resize(cellCount * this->landmarkCount);
+        for (int cell = 0; cell < cellCount; cell++) {
+            for (int i = 0; i < this->landmarkCount; i++) {
+                int distance = fields[i].distances[cell];
+                distances32[cell * this->landmarkCount + i] = (distance == FLOW_FIELD_UNREACHABLE) ? UINT32_MAX : (uint32_t)distance;
+            }
+        }
+    }
+}
+
+bool LandmarkTable::IsBuilt() const {
+    return !distances16.empty() || !distances32.empty();
+}
+
+// The bounds are only admissible for the grid and movement rules they were built from
+bool LandmarkTable::Matches(int mapWidth, int mapHeight, DiagonalMovement diagonalMovement) const {
+    return IsBuilt() && width == mapWidth && height == mapHeight && this->diagonalMovement == diagonalMovement;
+}
+
+int LandmarkTable::GetLowerBound(int indexA, int indexB) const {
+    if (!distances16.empty()) {
+        return GetTableLowerBound(&distances16[indexA * landmarkCount], &distances16[indexB * landmarkCount], landmarkCount, (uint16_t)UINT16_MAX);
+    }
+    return GetTableLowerBound(&distances32[indexA * landmarkCount], &distances32[indexB * landmarkCount], landmarkCount, (uint32_t)UINT32_MAX);
+}
+
+// Landmarks work best behind the cells being searched, so they go on the open cells closest to points
+// spaced evenly around the edge of the map
+void LandmarkTable::PlaceLandmarks(const ObstacleGrid& grid, int landmarkCount) {
+    landmarks.clear();
+    int perimeter = 2 * (width + height);
+    for (int i = 0; i < landmarkCount; i++) {
+        int distance = i * perimeter / landmarkCount;
+        glm::ivec2 edgePoint;
+        if (distance < width) {
+            edgePoint = glm::ivec2(distance, 0);
+        }
+        else if (distance < width + height) {
+            edgePoint = glm::ivec2(width - 1, distance - width);
+        }
+        else if (distance < 2 * width + height) {
+            edgePoint = glm::ivec2(width - 1 - (distance - width - height), height - 1);
+        }
+        else {
+            edgePoint = glm::ivec2(0, height - 1 - (distance - 2 * width - height));
+        }
+        int bestDistance = INT_MAX;
+        glm::ivec2 best(-1, -1);
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                int dx = x - edgePoint.x;
+                int dy = y - edgePoint.y;
+                if (dx * dx + dy * dy < bestDistance && !grid.IsBlocked(x, y) && std::find(landmarks.begin(), landmarks.end(), glm::ivec2(x, y)) == landmarks.end()) {
+                    bestDistance = dx * dx + dy * dy;
+                    best = glm::ivec2(x, y);
+                }
+            }
+        }
+        if (best.x != -1) {
+            landmarks.push_back(best);
+        }
+    }
+}
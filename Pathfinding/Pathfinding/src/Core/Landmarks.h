@@ -0,0 +1,26 @@
+#pragma once
+#include "Pathfinding.h"
+
+#define LANDMARK_COUNT 8
+
+// ALT (A*, landmarks, triangle inequality) heuristic. Exact distances from a few landmarks spread around the
+// edge of the map give the lower bound |d(L, a) - d(L, b)| for any two cells, which sees walls that octile
+// distance doesn't. Entries are 16 bit when every distance fits and 32 bit otherwise, with the landmarks of
+// one cell stored together so a lookup touches a single cache line.
+struct LandmarkTable {
+    int width = 0;
+    int height = 0;
+    int landmarkCount = 0;
+    DiagonalMovement diagonalMovement = DIAGONAL_NEVER;
+    std::vector<glm::ivec2> landmarks;
+    std::vector<uint16_t> distances16;  // landmarkCount entries per cell, UINT16_MAX where unreachable
+    std::vector<uint32_t> distances32;  // Used instead when a distance doesn't fit in 16 bits, UINT32_MAX where unreachable
+
+    void Build(const ObstacleGrid& grid, DiagonalMovement diagonalMovement, int landmarkCount, const TerrainCosts* terrain = nullptr);
+    bool IsBuilt() const;
+    bool Matches(int mapWidth, int mapHeight, DiagonalMovement diagonalMovement) const;
+    int GetLowerBound(int indexA, int indexB) const;
+
+private:
+    void PlaceLandmarks(const ObstacleGrid& grid, int landmarkCount);
+};
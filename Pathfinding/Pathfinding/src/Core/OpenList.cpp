@@ -0,0 +1,266 @@
+#include "Pathfinding.h"
+#include <algorithm>
+
+void BucketQueue::AllocateSpace(int size) {
+    next = std::vector<int>(size);
+    previous = std::vector<int>(size);
+}
+
+void BucketQueue::AddItem(int item) {
+    int bucket = nodes->f[item];
+    if (bucket >= (int)heads.size()) {
+        heads.resize(std::max(bucket + 1, (int)heads.size() * 2), -1);
+    }
+    // Newest first, so ties go to the deeper node like they tend to in the heap
+    next[item] = heads[bucket];
+    previous[item] = -1;
+    if (heads[bucket] != -1) {
+        previous[heads[bucket]] = item;
+    }
+    heads[bucket] = item;
+    nodes->heapIndex[item] = bucket;
+    minBucket = std::min(minBucket, bucket);
+    currentItemCount++;
+}
+
+// Moves the item to the bucket of its new f, which may be lower or higher than before
+void BucketQueue::Update(int item) {
+    if (nodes->heapIndex[item] == nodes->f[item]) {
+        return;
+    }
+    Unlink(item);
+    AddItem(item);
+}
+
+bool BucketQueue::IsEmpty() {
+    return (currentItemCount == 0);
+}
+
+int BucketQueue::Size() {
+    return currentItemCount;
+}
+
+void BucketQueue::Clear() {
+    if (currentItemCount > 0) {
+        std::fill(heads.begin(), heads.end(), -1);
+    }
+    currentItemCount = 0;
+    minBucket = (int)heads.size();
+}
+
+int BucketQueue::PeekFirst() {
+    while (heads[minBucket] == -1) {
+        minBucket++;
+    }
+    return heads[minBucket];
+}
+
+int BucketQueue::RemoveFirst() {
+    int item = PeekFirst();
+    Unlink(item);
+    return item;
+}
+
+// Debug drawing only, walks every bucket
+void BucketQueue::GetItems(std::vector<int>& items) {
+    items.clear();
+    for (int bucket = minBucket; bucket < (int)heads.size() && (int)items.size() < currentItemCount; bucket++) {
+        for (int item = heads[bucket]; item != -1; item = next[item]) {
+            items.push_back(item);
+        }
+    }
+}
+
+void BucketQueue::Unlink(int item) {
+    int bucket = nodes->heapIndex[item];
+    if (previous[item] != -1) {
+        next[previous[item]] = next[item];
+    }
+    else {
+        heads[bucket] = next[item];
+    }
+    if (next[item] != -1) {
+        previous[next[item]] = previous[item];
+    }
+    currentItemCount--;
+}
+
+void QuaternaryHeap::AllocateSpace(int size) {
+    entries = std::vector<Entry>(size);
+}
+
+void QuaternaryHeap::AddItem(int item) {
+    currentItemCount++;
+    SortUp(currentItemCount - 1, { GetKey(item), item });
+}
+
+// Re-sifts after f or g changed, in whichever direction the key moved
+void QuaternaryHeap::Update(int item) {
+    int position = nodes->heapIndex[item];
+    Entry entry = { GetKey(item), item };
+    if (entry.key < entries[position].key) {
+        SortUp(position, entry);
+    }
+    else {
+        SortDown(position, entry);
+    }
+}
+
+bool QuaternaryHeap::IsEmpty() {
+    return (currentItemCount == 0);
+}
+
+int QuaternaryHeap::Size() {
+    return currentItemCount;
+}
+
+void QuaternaryHeap::Clear() {
+    currentItemCount = 0;
+}
+
+int QuaternaryHeap::PeekFirst() {
+    return entries[0].item;
+}
+
+int QuaternaryHeap::RemoveFirst() {
+    int firstItem = entries[0].item;
+    currentItemCount--;
+    if (currentItemCount > 0) {
+        SortDown(0, entries[currentItemCount]);
+    }
+    return firstItem;
+}
+
+void QuaternaryHeap::GetItems(std::vector<int>& items) {
+    items.clear();
+    for (int i = 0; i < currentItemCount; i++) {
+        items.push_back(entries[i].item);
+    }
+}
+
+uint64_t QuaternaryHeap::GetKey(int item) {
+    return (uint64_t)(uint32_t)nodes->f[item] << 32 | (uint32_t)~nodes->g[item];
+}
+
+// Both sorts move the hole instead of swapping, so each level costs one entry copy
+void QuaternaryHeap::SortUp(int position, Entry entry) {
+    while (position > 0) {
+        int parentPosition = (position - 1) / 4;
+        if (entries[parentPosition].key <= entry.key) {
+            break;
+        }
+        entries[position] = entries[parentPosition];
+        nodes->heapIndex[entries[position].item] = position;
+        position = parentPosition;
+    }
+    entries[position] = entry;
+    nodes->heapIndex[entry.item] = position;
+}
+
+void QuaternaryHeap::SortDown(int position, Entry entry) {
+    while (true) {
+        int firstChild = position * 4 + 1;
+        if (firstChild >= currentItemCount) {
+            break;
+        }
+        int lastChild = std::min(firstChild + 4, currentItemCount);
+        int bestChild = firstChild;
+        for (int child = firstChild + 1; child < lastChild; child++) {
+            if (entries[child].key < entries[bestChild].key) {
+                bestChild = child;
+            }
+        }
+        if (entries[bestChild].key >= entry.key) {
+            break;
+        }
+        entries[position] = entries[bestChild];
+        nodes->heapIndex[entries[position].item] = position;
+        position = bestChild;
+    }
+    entries[position] = entry;
+    nodes->heapIndex[entry.item] = position;
+}
+
+// Only the queue in use gets storage, so switching types costs one allocation
+void OpenList::Init(NodeStore* nodes, OpenListType type) {
+    this->type = type;
+    heap.nodes = nodes;
+    buckets.nodes = nodes;
+    quaternaryHeap.nodes = nodes;
+    if (type == OPEN_LIST_BUCKET_QUEUE && buckets.next.size() != nodes->Size()) {
+        buckets.AllocateSpace(nodes->Size());
+    }
+    else if (type == OPEN_LIST_QUATERNARY_HEAP && quaternaryHeap.entries.size() != nodes->Size()) {
+        quaternaryHeap.AllocateSpace(nodes->Size());
+    }
+    else if (type == OPEN_LIST_BINARY_HEAP && heap.items.size() != nodes->Size()) {
+        heap.AllocateSpace(nodes->Size());
+    }
+    heap.Clear();
+    buckets.Clear();
+    quaternaryHeap.Clear();
+}
+
+void OpenList::AddItem(int item) {
+    switch (type) {
+        case OPEN_LIST_BUCKET_QUEUE: buckets.AddItem(item); break;
+        case OPEN_LIST_QUATERNARY_HEAP: quaternaryHeap.AddItem(item); break;
+        default: heap.AddItem(item); break;
+    }
+}
+
+void OpenList::Update(int item) {
+    switch (type) {
+        case OPEN_LIST_BUCKET_QUEUE: buckets.Update(item); break;
+        case OPEN_LIST_QUATERNARY_HEAP: quaternaryHeap.Update(item); break;
+        default: heap.Update(item); break;
+    }
+}
+
+bool OpenList::IsEmpty() {
+    switch (type) {
+        case OPEN_LIST_BUCKET_QUEUE: return buckets.IsEmpty();
+        case OPEN_LIST_QUATERNARY_HEAP: return quaternaryHeap.IsEmpty();
+        default: return heap.IsEmpty();
+    }
+}
+
+int OpenList::Size() {
+    switch (type) {
+        case OPEN_LIST_BUCKET_QUEUE: return buckets.Size();
+        case OPEN_LIST_QUATERNARY_HEAP: return quaternaryHeap.Size();
+        default: return heap.Size();
+    }
+}
+
+void OpenList::Clear() {
+    switch (type) {
+        case OPEN_LIST_BUCKET_QUEUE: buckets.Clear(); break;
+        case OPEN_LIST_QUATERNARY_HEAP: quaternaryHeap.Clear(); break;
+        default: heap.Clear(); break;
+    }
+}
+
+int OpenList::PeekFirst() {
+    switch (type) {
+        case OPEN_LIST_BUCKET_QUEUE: return buckets.PeekFirst();
+        case OPEN_LIST_QUATERNARY_HEAP: return quaternaryHeap.PeekFirst();
+        default: return heap.items[0];
+    }
+}
+
+int OpenList::RemoveFirst() {
+    switch (type) {
+        case OPEN_LIST_BUCKET_QUEUE: return buckets.RemoveFirst();
+        case OPEN_LIST_QUATERNARY_HEAP: return quaternaryHeap.RemoveFirst();
+        default: return heap.RemoveFirst();
+    }
+}
+
+void OpenList::GetItems(std::vector<int>& items) {
+    switch (type) {
+        case OPEN_LIST_BUCKET_QUEUE: buckets.GetItems(items); break;
+        case OPEN_LIST_QUATERNARY_HEAP: quaternaryHeap.GetItems(items); break;
+        default: items.assign(heap.items.begin(), heap.items.begin() + heap.Size()); break;
+    }
+}
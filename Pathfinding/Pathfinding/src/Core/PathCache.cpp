@@ -0,0 +1,167 @@
+#include "PathCache.h"
+#include <algorithm>
+#include <cstdlib>
+
+void PathCache::Init(int mapWidth, int mapHeight, int capacity) {
+    m_mapWidth = mapWidth;
+    m_mapHeight = mapHeight;
+    m_chunksX = (mapWidth + PATH_CACHE_CHUNK_SIZE - 1) / PATH_CACHE_CHUNK_SIZE;
+    m_chunksY = (mapHeight + PATH_CACHE_CHUNK_SIZE - 1) / PATH_CACHE_CHUNK_SIZE;
+    m_capacity = capacity;
+    m_chunkVersions.assign(m_chunksX * m_chunksY, 0);
+    Clear();
+}
+
+void PathCache::Clear() {
+    m_entries.clear();
+    m_lookup.clear();
+}
+
+// Call whenever a cell is toggled
+void PathCache::OnCellChanged(int x, int y) {
+    if (x < 0 || y < 0 || x >= m_mapWidth || y >= m_mapHeight) {
+        return;
+    }
+    m_chunkVersions[GetChunkIndex(x, y)]++;
+    m_mapVersion++;
+}
+
+bool PathCache::Find(const PathRequest& request, const SearchConfig& config, PathResult& result) {
+    auto it = m_lookup.find(GetKey(request, config));
+    if (it == m_lookup.end()) {
+        m_stats.misses++;
+        return false;
+    }
+    if (!IsValid(*it->second)) {
+        m_entries.erase(it->second);
+        m_lookup.erase(it);
+        m_stats.invalidations++;
+        m_stats.misses++;
+        return false;
+    }
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    result = it->second->result;
+    result.expandedNodes = 0;
+    m_stats.hits++;
+    return true;
+}
+
+void PathCache::Store(const PathRequest& request, const SearchConfig& config, const PathResult& result) {
+    if (m_capacity <= 0) {
+        return;
+    }
+    if (request.startX < 0 || request.startY < 0 || request.startX >= m_mapWidth || request.startY >= m_mapHeight ||
+        request.targetX < 0 || request.targetY < 0 || request.targetX >= m_mapWidth || request.targetY >= m_mapHeight) {
+        return;
+    }
+    uint64_t key = GetKey(request, config);
+    auto it = m_lookup.find(key);
+    if (it != m_lookup.end()) {
+        m_entries.erase(it->second);
+        m_lookup.erase(it);
+    }
+    Entry entry;
+    entry.key = key;
+    entry.result = result;
+    entry.mapVersion = m_mapVersion;
+    if (result.found) {
+        // Every chunk the path passes through. Lazy Theta* paths are only their turning points, so each
+        // segment is walked cell by cell rather than assuming consecutive cells are neighbours.
+        std::vector<int> chunks;
+        int x = request.startX;
+        int y = request.startY;
+        AddChunk(x, y, chunks);
+        for (int index : result.path) {
+            int nextX = index % m_mapWidth;
+            int nextY = index / m_mapWidth;
+            AddSegmentChunks(x, y, nextX, nextY, chunks);
+            x = nextX;
+            y = nextY;
+        }
+        std::sort(chunks.begin(), chunks.end());
+        chunks.erase(std::unique(chunks.begin(), chunks.end()), chunks.end());
+        for (int chunk : chunks) {
+            entry.chunks.push_back({ chunk, m_chunkVersions[chunk] });
+        }
+    }
+    m_entries.push_front(std::move(entry));
+    m_lookup[key] = m_entries.begin();
+    while ((int)m_entries.size() > m_capacity) {
+        m_lookup.erase(m_entries.back().key);
+        m_entries.pop_back();
+        m_stats.evictions++;
+    }
+}
+
+int PathCache::GetSize() const {
+    return (int)m_entries.size();
+}
+
+const PathCacheStats& PathCache::GetStats() const {
+    return m_stats;
+}
+
+void PathCache::ResetStats() {
+    m_stats = PathCacheStats();
+}
+
+// Start and target cell indices take 24 bits each, the search mode a byte and the heuristic and diagonal movement 4 bits each
+uint64_t PathCache::GetKey(const PathRequest& request, const SearchConfig& config) const {
+    uint64_t start = (uint64_t)(request.startY * m_mapWidth + request.startX) & 0xFFFFFF;
+    uint64_t target = (uint64_t)(request.targetY * m_mapWidth + request.targetX) & 0xFFFFFF;
+    return start << 40 | target << 16 | (uint64_t)config.searchMode << 8 | (uint64_t)config.heuristic << 4 | (uint64_t)config.diagonalMovement;
+}
+
+int PathCache::GetChunkIndex(int x, int y) const {
+    return (y / PATH_CACHE_CHUNK_SIZE) * m_chunksX + x / PATH_CACHE_CHUNK_SIZE;
+}
+
+void PathCache::AddChunk(int x, int y, std::vector<int>& chunks) const {
+    if (x >= 0 && y >= 0 && x < m_mapWidth && y < m_mapHeight) {
+        chunks.push_back(GetChunkIndex(x, y));
+    }
+}
+
+// Chunks of every cell the segment between the two cell centres touches, past the first. Where it
+// passes exactly through a corner both cells beside it count, since either corner policy looks at them.
+void PathCache::AddSegmentChunks(int x0, int y0, int x1, int y1, std::vector<int>& chunks) const {
+    int dx = std::abs(x1 - x0);
+    int dy = std::abs(y1 - y0);
+    int stepX = (x1 > x0) - (x1 < x0);
+    int stepY = (y1 > y0) - (y1 < y0);
+    int x = x0;
+    int y = y0;
+    for (int ix = 0, iy = 0; ix < dx || iy < dy; ) {
+        // Compares where the segment crosses the next vertical and the next horizontal grid line
+        int64_t decision = (int64_t)(1 + 2 * ix) * dy - (int64_t)(1 + 2 * iy) * dx;
+        if (decision == 0) {
+            AddChunk(x + stepX, y, chunks);
+            AddChunk(x, y + stepY, chunks);
+            x += stepX;
+            y += stepY;
+            ix++;
+            iy++;
+        }
+        else if (decision < 0) {
+            x += stepX;
+            ix++;
+        }
+        else {
+            y += stepY;
+            iy++;
+        }
+        AddChunk(x, y, chunks);
+    }
+}
+
+bool PathCache::IsValid(const Entry& entry) const {
+    if (!entry.result.found) {
+        return entry.mapVersion == m_mapVersion;
+    }
+    for (const ChunkVersion& chunkVersion : entry.chunks) {
+        if (m_chunkVersions[chunkVersion.chunk] != chunkVersion.version) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include "Pathfinding.h"
+#include <list>
+#include <unordered_map>
+
+#define PATH_CACHE_CHUNK_SIZE 8
+#define PATH_CACHE_CAPACITY 1024
+
+struct PathCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t invalidations = 0;   // Lookups that found an entry an edit had made stale, also counted as misses
+    uint64_t evictions = 0;
+};
+
+// Least recently used cache of solved queries. The map is cut into chunks that each count their edits,
+// and an entry remembers the count of every chunk its path touches. It stays valid until one of those
+// chunks is edited, so edits elsewhere don't throw it away. Failed queries depend on the whole map, so
+// any edit invalidates them.
+struct PathCache {
+    void Init(int mapWidth, int mapHeight, int capacity);
+    void Clear();
+    void OnCellChanged(int x, int y);
+    bool Find(const PathRequest& request, const SearchConfig& config, PathResult& result);
+    void Store(const PathRequest& request, const SearchConfig& config, const PathResult& result);
+    int GetSize() const;
+    const PathCacheStats& GetStats() const;
+    void ResetStats();
+
+private:
+    struct ChunkVersion {
+        int chunk = 0;
+        uint32_t version = 0;
+    };
+    struct Entry {
+        uint64_t key = 0;
+        PathResult result;
+        std::vector<ChunkVersion> chunks;
+        uint32_t mapVersion = 0;  // Only checked for failed queries
+    };
+
+    uint64_t GetKey(const PathRequest& request, const SearchConfig& config) const;
+    int GetChunkIndex(int x, int y) const;
+    void AddChunk(int x, int y, std::vector<int>& chunks) const;
+    void AddSegmentChunks(int x0, int y0, int x1, int y1, std::vector<int>& chunks) const;
+    bool IsValid(const Entry& entry) const;
+
+    int m_mapWidth = 0;
+    int m_mapHeight = 0;
+    int m_chunksX = 0;
+    int m_chunksY = 0;
+    int m_capacity = 0;
+    uint32_t m_mapVersion = 0;
+    std::vector<uint32_t> m_chunkVersions;
+    std::list<Entry> m_entries;   // Most recently used first
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> m_lookup;
+    PathCacheStats m_stats;
+};
@@ -0,0 +1,82 @@
+#include "PathWorkerPool.h"
+
+PathWorkerPool::~PathWorkerPool() {
+    Shutdown();
+}
+
+void PathWorkerPool::Init(int threadCount) {
+    Shutdown();
+    m_shutdown = false;
+    // Sized before any thread starts, the contexts must never move once a search has pointed into them
+    m_contexts = std::vector<AStar>(threadCount);
+    for (int i = 0; i < threadCount; i++) {
+        m_threads.emplace_back(&PathWorkerPool::WorkerLoop, this, i);
+    }
+}
+
+void PathWorkerPool::Shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_shutdown = true;
+    }
+    m_batchReady.notify_all();
+    for (std::thread& thread : m_threads) {
+        thread.join();
+    }
+    m_threads.clear();
+}
+
+int PathWorkerPool::GetThreadCount() {
+    return (int)m_threads.size();
+}
+
+// Hands the batch to the workers and blocks until it is finished. Requests are claimed one at a time,
+// so a few long queries don't leave the other workers idle.
+void PathWorkerPool::FindPaths(const MapView& map, const SearchConfig& config, const std::vector<PathRequest>& requests, std::vector<PathResult>& results) {
+    results.resize(requests.size());
+    if (requests.empty() || m_threads.empty()) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_map = map;
+    m_config = config;
+    m_requests = &requests;
+    m_results = &results;
+    m_nextRequest = 0;
+    m_busyWorkers = (int)m_threads.size();
+    m_batchIndex++;
+    m_batchReady.notify_all();
+    m_batchDone.wait(lock, [this] { return m_busyWorkers == 0; });
+}
+
+void PathWorkerPool::WorkerLoop(int workerIndex) {
+    uint64_t lastBatchIndex = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_batchReady.wait(lock, [&] { return m_shutdown || m_batchIndex != lastBatchIndex; });
+            if (m_shutdown) {
+                return;
+            }
+            lastBatchIndex = m_batchIndex;
+        }
+        int requestCount = (int)m_requests->size();
+        for (int i = m_nextRequest++; i < requestCount; i = m_nextRequest++) {
+            Solve(m_contexts[workerIndex], (*m_requests)[i], (*m_results)[i]);
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_busyWorkers--;
+        }
+        m_batchDone.notify_one();
+    }
+}
+
+void PathWorkerPool::Solve(AStar& context, const PathRequest& request, PathResult& result) {
+    context.InitSearch(m_map, m_config, request.startX, request.startY, request.targetX, request.targetY);
+    context.FindPath();
+    result.found = context.GridPathFound();
+    result.cost = context.GetPathCost();
+    result.expandedNodes = (int)context.GetClosedList().size();
+    result.path.assign(context.GetPath().begin(), context.GetPath().end());
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include "Pathfinding.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Fixed set of threads that solve batches of path requests. Each worker keeps its own AStar, so node
+// storage is allocated once per worker and reused by every query it runs.
+struct PathWorkerPool {
+    ~PathWorkerPool();
+    void Init(int threadCount);
+    void Shutdown();
+    void FindPaths(const MapView& map, const SearchConfig& config, const std::vector<PathRequest>& requests, std::vector<PathResult>& results);
+    int GetThreadCount();
+
+private:
+    void WorkerLoop(int workerIndex);
+    void Solve(AStar& context, const PathRequest& request, PathResult& result);
+
+    std::vector<std::thread> m_threads;
+    std::vector<AStar> m_contexts;
+    std::mutex m_mutex;
+    std::condition_variable m_batchReady;
+    std::condition_variable m_batchDone;
+    MapView m_map;
+    SearchConfig m_config;
+    const std::vector<PathRequest>* m_requests = nullptr;
+    std::vector<PathResult>* m_results = nullptr;
+    std::atomic<int> m_nextRequest = 0;
+    int m_busyWorkers = 0;
+    uint64_t m_batchIndex = 0;
+    bool m_shutdown = false;
+};
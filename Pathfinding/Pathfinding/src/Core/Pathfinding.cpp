@@ -1,11 +1,29 @@
 #include "Pathfinding.h"
 #include "Input.h"
+#include "AnytimeAStar.h"
+#include "ConnectedComponents.h"
+#include "ContractionHierarchy.h"
+#include "DStarLite.h"
+#include "FlowField.h"
+#include "HierarchicalPathfinding.h"
+#include "JumpDistances.h"
+#include "Landmarks.h"
+#include "PathCache.h"
+#include "PathWorkerPool.h"
+#include "SearchPolicies.h"
 #include "../BackEnd/BackEnd.h"
 #include "../Core/Audio.hpp"
 #include "../Core/JSON.hpp"
 #include "../Renderer/RendererCommon.h"
+#include "../Timer.hpp"
 #include "../Util.hpp"
 #include <algorithm>
+#include <bit>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <future>
+#include <thread>
 
 namespace Pathfinding {
 
@@ -13,30 +31,220 @@ namespace Pathfinding {
     int g_mapHeight = 0;
     ivec2 g_start;
     ivec2 g_target;
-    std::vector<std::vector<bool>> g_map;
+    ObstacleGrid g_map;
+    TerrainCosts g_terrain;
+    JumpDistanceTable g_jumpDistances;
+    ConnectedComponents g_components;
+    LandmarkTable g_landmarks;
+    std::future<LandmarkTable> g_landmarkBuild;
+    bool g_landmarksValid = false;
+    bool g_landmarkBuildRequested = false;
+    HierarchicalPathfinder g_hpa;
+    HierarchicalPath g_hpaPath;
+    FlowField g_flowField;
+    DStarLite g_dstar;
+    AnytimeAStar g_ara;
+    int g_araShownRevision = 0;
+    ContractionHierarchy g_contractionHierarchies[DIAGONAL_MOVEMENT_COUNT];
+    bool g_contractionHierarchiesValid = false;
+    bool g_flowFieldDirty = true;
+    bool g_showFlowField = false;
+    PathWorkerPool g_pathWorkers;
+    PathCache g_pathCache;
     AStar g_AStar;
     bool g_slowMode = true;
+    SearchMode g_searchMode = SEARCH_MODE_ASTAR;
+    DiagonalMovement g_diagonalMovement = DIAGONAL_NEVER;
+    OpenListType g_openListType = OPEN_LIST_QUATERNARY_HEAP;
+    HeuristicType g_heuristic = HEURISTIC_OCTILE;
+    const int g_terrainBrushWeights[] = { 0, 2, 4, 8 }; // 0 paints walls
+    int g_terrainBrush = 0;
 
     void Init() {
         g_mapWidth = PRESENT_WIDTH / CELL_SIZE;
         g_mapHeight = PRESENT_HEIGHT / CELL_SIZE + 1;
-        g_map.resize(g_mapWidth, std::vector<bool>(g_mapHeight, false));
+        g_map.Resize(g_mapWidth, g_mapHeight);
+        g_terrain.Resize(g_mapWidth, g_mapHeight);
+        g_pathCache.Init(g_mapWidth, g_mapHeight, PATH_CACHE_CAPACITY);
         LoadMap();
     }
 
     void ResetAStar() {
         g_AStar.ClearData();
+        g_hpaPath.Clear();
+        g_ara.Clear();
+    }
+
+    // Plans on the cluster graph first, then refines one abstract edge per step in slow mode
+    void FindHierarchicalPath() {
+        if (!g_hpaPath.searched) {
+            g_hpa.FindAbstractPath(g_start.x, g_start.y, g_target.x, g_target.y, g_hpaPath);
+            if (g_slowMode) {
+                return;
+            }
+        }
+        if (g_slowMode) {
+            g_hpa.RefineNextSegment(g_hpaPath);
+        }
+        else {
+            while (g_hpa.RefineNextSegment(g_hpaPath));
+        }
+        if (g_hpaPath.IsRefined()) {
+            g_AStar.SetFinalPath(g_hpaPath.cells);
+        }
+    }
+
+    // Landmark tables are built from a copy of the grid on other threads while the map stays editable. Adding
+    // a wall only makes paths longer, so the old bounds stay admissible, but anything else that changes the
+    // map has to wait for a new table. A build that finishes after such a change is thrown away.
+    void RequestLandmarkBuild() {
+        g_landmarksValid = false;
+        g_landmarkBuildRequested = true;
+    }
+
+    void UpdateLandmarkBuild() {
+        if (g_landmarkBuild.valid() && g_landmarkBuild.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            LandmarkTable landmarks = g_landmarkBuild.get();
+            if (!g_landmarkBuildRequested) {
+                g_landmarks = std::move(landmarks);
+                g_landmarksValid = true;
+            }
+        }
+        if (g_landmarkBuildRequested && !g_landmarkBuild.valid()) {
+            g_landmarkBuildRequested = false;
+            g_landmarkBuild = std::async(std::launch::async, [grid = g_map, terrain = g_terrain, diagonalMovement = g_diagonalMovement]() {
+                LandmarkTable landmarks;
+                landmarks.Build(grid, diagonalMovement, LANDMARK_COUNT, terrain.IsUniform() ? nullptr : &terrain);
+                return landmarks;
+            });
+        }
+    }
+
+    // Keeps the D* Lite search between calls, so after an edit only the part of it that changed is searched again
+    void FindDStarLitePath() {
+        if (!g_dstar.Matches(g_target.x, g_target.y, g_diagonalMovement)) {
+            g_dstar.Init(g_map, g_start.x, g_start.y, g_target.x, g_target.y, g_diagonalMovement, &g_terrain);
+        }
+        else {
+            g_dstar.MoveStart(g_start.x, g_start.y);
+        }
+        std::vector<int> path;
+        if (g_dstar.ComputeShortestPath() && g_dstar.GetPath(path)) {
+            g_AStar.SetFinalPath(path);
+        }
+    }
+
+    // Edits throw the AStar search away, but a D* Lite search repairs itself and can show the new path straight away
+    void RepairDStarLitePath() {
+        if (g_searchMode == SEARCH_MODE_DSTAR_LITE && g_dstar.IsInitialized()) {
+            g_AStar.InitSearch(GetMapView(), GetSearchConfig(), g_start.x, g_start.y, g_target.x, g_target.y);
+            FindDStarLitePath();
+        }
+    }
+
+    // Space starts an ARA* search, which then shows a path as soon as it has one and keeps improving it with
+    // a slice of every frame, or one expansion per frame while space is held in slow mode
+    void UpdateAnytimePath() {
+        if (Input::KeyDown(HELL_KEY_SPACE) && !g_ara.IsInitialized()) {
+            g_AStar.InitSearch(GetMapView(), GetSearchConfig(), g_start.x, g_start.y, g_target.x, g_target.y);
+            g_ara.Init(GetMapView(), GetSearchConfig(), g_start.x, g_start.y, g_target.x, g_target.y);
+            g_araShownRevision = 0;
+        }
+        if (!g_ara.IsInitialized() || g_ara.IsFinished()) {
+            return;
+        }
+        if (!g_slowMode) {
+            g_ara.Improve(INT_MAX, SEARCH_FRAME_BUDGET_US);
+        }
+        else if (Input::KeyDown(HELL_KEY_SPACE)) {
+            g_ara.Improve(1);
+        }
+        if (g_ara.GetPathRevision() != g_araShownRevision) {
+            g_araShownRevision = g_ara.GetPathRevision();
+            g_AStar.SetFinalPath(g_ara.GetPath());
+        }
+    }
+
+    // Random queries between open cells of the current map
+    void GetRandomRequests(int count, std::vector<PathRequest>& requests) {
+        std::vector<ivec2> openCells;
+        for (int y = 0; y < g_mapHeight; y++) {
+            for (int x = 0; x < g_mapWidth; x++) {
+                if (!g_map.IsBlocked(x, y)) {
+                    openCells.push_back(ivec2(x, y));
+                }
+            }
+        }
+        requests.clear();
+        if (openCells.empty()) {
+            return;
+        }
+        for (int i = 0; i < count; i++) {
+            ivec2 start = openCells[rand() % openCells.size()];
+            ivec2 target = openCells[rand() % openCells.size()];
+            requests.push_back({ start.x, start.y, target.x, target.y });
+        }
+    }
+
+    // Solves a batch of random queries on the worker pool and prints how long it took
+    void BenchmarkPathBatch() {
+        std::vector<PathRequest> requests;
+        std::vector<PathResult> results;
+        GetRandomRequests(256, requests);
+        if (requests.empty()) {
+            return;
+        }
+        {
+            Timer timer("Path batch");
+            FindPaths(requests, results);
+        }
+        int foundCount = (int)std::count_if(results.begin(), results.end(), [](const PathResult& result) { return result.found; });
+        std::cout << "Found " << foundCount << "/" << requests.size() << " paths on " << g_pathWorkers.GetThreadCount() << " threads\n";
+        const PathCacheStats& stats = g_pathCache.GetStats();
+        std::cout << "Path cache: " << g_pathCache.GetSize() << " entries, " << stats.hits << " hits, " << stats.misses << " misses, " << stats.invalidations << " invalidations, " << stats.evictions << " evictions\n";
+    }
+
+    // Runs the same random queries with every open list type on this thread and prints how long each took
+    void BenchmarkOpenLists() {
+        std::vector<PathRequest> requests;
+        GetRandomRequests(256, requests);
+        AStar aStar;
+        for (int type = 0; type < OPEN_LIST_TYPE_COUNT; type++) {
+            SearchConfig config = GetSearchConfig();
+            config.openList = (OpenListType)type;
+            int expandedNodes = 0;
+            auto startTime = std::chrono::steady_clock::now();
+            for (int pass = 0; pass < 10; pass++) {
+                for (const PathRequest& request : requests) {
+                    aStar.InitSearch(GetMapView(), config, request.startX, request.startY, request.targetX, request.targetY);
+                    aStar.FindPath();
+                    expandedNodes += aStar.GetForwardExpansions() + aStar.GetBackwardExpansions();
+                }
+            }
+            std::chrono::duration<float> duration = std::chrono::steady_clock::now() - startTime;
+            std::cout << Util::OpenListTypeToString(config.openList) << ": " << std::format("{:.4f}", duration.count() * 1000.0f) << "ms for " << requests.size() * 10 << " paths, " << expandedNodes << " expanded\n";
+        }
     }
 
     void Update(float deltaTime) {
 
+        UpdateLandmarkBuild();
+
         if (Input::LeftMouseDown()) {
-            SetObstacle(GetMouseCellX(), GetMouseCellY(), true);
+            if (g_terrainBrushWeights[g_terrainBrush] == 0) {
+                SetObstacle(GetMouseCellX(), GetMouseCellY(), true);
+            }
+            else {
+                SetTerrainWeight(GetMouseCellX(), GetMouseCellY(), g_terrainBrushWeights[g_terrainBrush]);
+            }
             ResetAStar();
+            RepairDStarLitePath();
         }
         if (Input::RightMouseDown()) {
             SetObstacle(GetMouseCellX(), GetMouseCellY(), false);
+            SetTerrainWeight(GetMouseCellX(), GetMouseCellY(), 1);
             ResetAStar();
+            RepairDStarLitePath();
         }
         if (Input::KeyPressed(HELL_KEY_L)) {
             Audio::PlayAudio("SELECT.wav", 1.0);
@@ -57,6 +265,48 @@ namespace Pathfinding {
             g_slowMode = !g_slowMode;
             ResetAStar();
         }
+        if (Input::KeyPressed(HELL_KEY_M)) {
+            Audio::PlayAudio("SELECT.wav", 1.0);
+            g_searchMode = (SearchMode)((g_searchMode + 1) % SEARCH_MODE_COUNT);
+            ResetAStar();
+        }
+        if (Input::KeyPressed(HELL_KEY_C)) {
+            Audio::PlayAudio("SELECT.wav", 1.0);
+            g_diagonalMovement = (DiagonalMovement)((g_diagonalMovement + 1) % DIAGONAL_MOVEMENT_COUNT);
+            g_jumpDistances.Build(g_map, g_diagonalMovement);
+            g_hpa.Build(g_map, g_diagonalMovement, &g_terrain);
+            g_components.Build(g_map, g_diagonalMovement);
+            g_flowFieldDirty = true;
+            RequestLandmarkBuild();
+            ResetAStar();
+        }
+        if (Input::KeyPressed(HELL_KEY_T)) {
+            Audio::PlayAudio("SELECT.wav", 1.0);
+            g_terrainBrush = (g_terrainBrush + 1) % (sizeof(g_terrainBrushWeights) / sizeof(g_terrainBrushWeights[0]));
+        }
+        if (Input::KeyPressed(HELL_KEY_H)) {
+            Audio::PlayAudio("SELECT.wav", 1.0);
+            g_heuristic = (HeuristicType)((g_heuristic + 1) % HEURISTIC_TYPE_COUNT);
+            ResetAStar();
+        }
+        if (Input::KeyPressed(HELL_KEY_F)) {
+            Audio::PlayAudio("SELECT.wav", 1.0);
+            g_showFlowField = !g_showFlowField;
+        }
+        if (Input::KeyPressed(HELL_KEY_O)) {
+            Audio::PlayAudio("SELECT.wav", 1.0);
+            g_openListType = (OpenListType)((g_openListType + 1) % OPEN_LIST_TYPE_COUNT);
+            g_hpa.SetOpenListType(g_openListType);
+            ResetAStar();
+        }
+        if (Input::KeyPressed(HELL_KEY_K)) {
+            Audio::PlayAudio("SELECT.wav", 1.0);
+            BenchmarkOpenLists();
+        }
+        if (Input::KeyPressed(HELL_KEY_B)) {
+            Audio::PlayAudio("SELECT.wav", 1.0);
+            BenchmarkPathBatch();
+        }
         if (Input::KeyPressed(HELL_KEY_1)) {
             Audio::PlayAudio("SELECT.wav", 1.0);
             SetStart(GetMouseCellX(), GetMouseCellY());
@@ -70,38 +320,97 @@ namespace Pathfinding {
         if (Input::KeyPressed(HELL_KEY_SPACE)) {
             Audio::PlayAudio("SELECT.wav", 1.0);
         }
-        if (Input::KeyDown(HELL_KEY_SPACE) && !g_AStar.GridPathFound()) {
+        if (g_searchMode == SEARCH_MODE_ARA) {
+            UpdateAnytimePath();
+        }
+        else if (Input::KeyDown(HELL_KEY_SPACE) && !g_AStar.GridPathFound()) {
             Audio::PlayAudio("UI_Select.wav", 0.5);
             if (!g_AStar.SearchInitilized()) {
-                g_AStar.InitSearch(g_map, g_start.x, g_start.y, g_target.x, g_target.y);
+                g_AStar.InitSearch(GetMapView(), GetSearchConfig(), g_start.x, g_start.y, g_target.x, g_target.y);
             }
-            if (!g_AStar.GridPathFound()) {
-                g_AStar.FindPath();
+            if (g_searchMode == SEARCH_MODE_HPA) {
+                FindHierarchicalPath();
+            }
+            else if (g_searchMode == SEARCH_MODE_DSTAR_LITE) {
+                FindDStarLitePath();
+            }
+            else if (g_slowMode) {
+                g_AStar.Step(1);
             }
         }
+        // Once started, a search carries on by itself and gets a slice of every frame until it is done
+        if (!g_slowMode && g_searchMode != SEARCH_MODE_HPA && g_searchMode != SEARCH_MODE_DSTAR_LITE && g_searchMode != SEARCH_MODE_ARA && g_AStar.SearchInitilized()) {
+            g_AStar.Step(INT_MAX, SEARCH_FRAME_BUDGET_US);
+        }
         if (Input::KeyPressed(HELL_KEY_W) || Input::KeyPressed(HELL_KEY_A)) {
             Audio::PlayAudio("SELECT.wav", 1.0);
         }
         if (Input::KeyDown(HELL_KEY_W) && !g_AStar.SmoothPathFound() || Input::KeyPressed(HELL_KEY_A)) {
             Audio::PlayAudio("UI_Select.wav", 0.5);
             if (!g_AStar.SmoothPathFound()) {
-                g_AStar.FindSmoothPath();
+                g_AStar.FindSmoothPath(g_slowMode ? 1 : INT_MAX);
             }
         }
     }
 
-    void ClearMap() {
-        for (int y = 0; y < GetMapWidth(); ++y) {
-            for (int x = 0; x < GetMapHeight(); ++x) {
-                g_map[y][x] = false;
-            }
-        }
+    void ResetMap() {
+        g_map.Clear();
+        g_terrain.Clear();
         g_start = { 0,0 };
         g_target = { 0,1 };
     }
 
+    // Rebuild everything derived from the obstacle grid after it was replaced wholesale
+    void RebuildMapData() {
+        g_jumpDistances.Build(g_map, g_diagonalMovement);
+        g_hpa.Build(g_map, g_diagonalMovement, &g_terrain);
+        g_components.Build(g_map, g_diagonalMovement);
+        g_dstar.Clear();
+        g_pathCache.Clear();
+        g_contractionHierarchiesValid = false;
+        RequestLandmarkBuild();
+        g_flowFieldDirty = true;
+    }
+
+    // Contraction hierarchies take far longer to build than anything else derived from the map, so they are
+    // only built when the map is saved, one per movement rule, and stored next to it. Loading just checks
+    // they were built from the same walls and terrain. Any edit leaves them stale until the next save.
+    void SaveContractionHierarchies() {
+        if (!g_contractionHierarchiesValid) {
+            Timer timer("Contraction hierarchy build");
+            for (int i = 0; i < DIAGONAL_MOVEMENT_COUNT; i++) {
+                g_contractionHierarchies[i].Build(g_map, (DiagonalMovement)i, g_terrain.IsUniform() ? nullptr : &g_terrain);
+            }
+            g_contractionHierarchiesValid = true;
+        }
+        std::ofstream out("res/maps/mappp.ch", std::ios::binary);
+        for (const ContractionHierarchy& hierarchy : g_contractionHierarchies) {
+            hierarchy.Save(out);
+        }
+    }
+
+    void LoadContractionHierarchies() {
+        std::ifstream in("res/maps/mappp.ch", std::ios::binary);
+        uint64_t mapHash = ContractionHierarchy::HashMap(g_map, g_terrain.IsUniform() ? nullptr : &g_terrain);
+        g_contractionHierarchiesValid = true;
+        for (int i = 0; i < DIAGONAL_MOVEMENT_COUNT; i++) {
+            ContractionHierarchy& hierarchy = g_contractionHierarchies[i];
+            if (!hierarchy.Load(in) || !hierarchy.Matches(g_mapWidth, g_mapHeight, (DiagonalMovement)i) || hierarchy.mapHash != mapHash) {
+                g_contractionHierarchiesValid = false;
+            }
+        }
+        if (!g_contractionHierarchiesValid) {
+            std::cout << "No contraction hierarchies for this map, save it to build them\n";
+        }
+    }
+
+    void ClearMap() {
+        ResetMap();
+        RebuildMapData();
+    }
+
     void LoadMap() {
-        ClearMap();
+        ResetMap();
         std::string fullPath = "res/maps/mappp.txt";
         if (Util::FileExists(fullPath)) {
             std::cout << "Loading map '" << fullPath << "'\n";
@@ -113,7 +422,19 @@ namespace Pathfinding {
                 for (const auto& jsonObject : data["map"]) {
                     int x = jsonObject["position"]["x"];
                     int y = jsonObject["position"]["y"];
-                    SetObstacle(x, y, true);
+                    if (IsInBounds(x, y)) {
+                        g_map.Set(x, y, true);
+                    }
+                }
+                // Maps saved before terrain existed have no weights, which is all plain ground
+                if (data.contains("terrain")) {
+                    for (const auto& jsonObject : data["terrain"]) {
+                        int x = jsonObject["position"]["x"];
+                        int y = jsonObject["position"]["y"];
+                        if (IsInBounds(x, y)) {
+                            g_terrain.Set(x, y, jsonObject["weight"]);
+                        }
+                    }
                 }
                 g_start.x = data["start"]["x"];
                 g_start.y = data["start"]["y"];
@@ -121,22 +442,43 @@ namespace Pathfinding {
                 g_target.y = data["target"]["y"];
             }
         }
+        RebuildMapData();
+        LoadContractionHierarchies();
     }
 
     void SaveMap() {
         JSONObject saveFile;
         nlohmann::json data;
         nlohmann::json jsonMap = nlohmann::json::array();
-        for (int x = 0; x < GetMapWidth(); x++) {
-            for (int y = 0; y < GetMapHeight(); y++) {
-                if (IsObstacle(x, y)) {
+        for (int y = 0; y < GetMapHeight(); y++) {
+            for (int x = 0; x < GetMapWidth(); x += 64) {
+                uint64_t rowBits = g_map.GetRowBits(x, y);
+                int count = std::min(64, GetMapWidth() - x);
+                if (count < 64) {
+                    rowBits &= (1ull << count) - 1;
+                }
+                while (rowBits) {
+                    int cellX = x + std::countr_zero(rowBits);
+                    rowBits &= rowBits - 1;
                     nlohmann::json jsonObject;
-                    jsonObject["position"] = { {"x", x}, {"y", y} };
+                    jsonObject["position"] = { {"x", cellX}, {"y", y} };
                     jsonMap.push_back(jsonObject);
                 }
             }
         }
         data["map"] = jsonMap;
+        nlohmann::json jsonTerrain = nlohmann::json::array();
+        for (int y = 0; y < GetMapHeight(); y++) {
+            for (int x = 0; x < GetMapWidth(); x++) {
+                if (g_terrain.Get(x, y) != 1) {
+                    nlohmann::json jsonObject;
+                    jsonObject["position"] = { {"x", x}, {"y", y} };
+                    jsonObject["weight"] = g_terrain.Get(x, y);
+                    jsonTerrain.push_back(jsonObject);
+                }
+            }
+        }
+        data["terrain"] = jsonTerrain;
         data["start"] = { {"x", g_start.x}, {"y", g_start.y} };
         data["target"] = { {"x", g_target.x}, {"y", g_target.y} };
         int indent = 4;
@@ -146,6 +488,7 @@ namespace Pathfinding {
         out << text;
         out.close();
         std::cout << "Saving map\n";
+        SaveContractionHierarchies();
     }
 
     void SetStart(int x, int y) {
@@ -157,6 +500,7 @@ namespace Pathfinding {
     void SetTarget(int x, int y) {
         if (IsInBounds(x, y)) {
             g_target = { x , y };
+            g_flowFieldDirty = true;
         }
     }
 
@@ -165,14 +509,52 @@ namespace Pathfinding {
     }
 
     void SetObstacle(int x, int y, bool value) {
-        if (IsInBounds(x, y)) {
-            g_map[x][y] = value;
+        if (IsInBounds(x, y) && g_map.IsBlocked(x, y) != value) {
+            g_map.Set(x, y, value);
+            g_jumpDistances.UpdateCell(g_map, x, y);
+            g_hpa.UpdateCell(g_map, x, y);
+            g_components.UpdateCell(g_map, x, y);
+            if (g_dstar.IsInitialized()) {
+                g_dstar.UpdateCell(x, y);
+            }
+            g_pathCache.OnCellChanged(x, y);
+            g_contractionHierarchiesValid = false;
+            if (!value) {
+                RequestLandmarkBuild();
+            }
+            g_flowFieldDirty = true;
+        }
+    }
+
+    // Heavier terrain only makes paths longer, so like a new wall it leaves the landmark bounds admissible
+    void SetTerrainWeight(int x, int y, int weight) {
+        if (IsInBounds(x, y) && g_terrain.Get(x, y) != weight) {
+            bool lighter = weight < g_terrain.Get(x, y);
+            g_terrain.Set(x, y, weight);
+            g_hpa.UpdateCell(g_map, x, y);
+            if (g_dstar.IsInitialized()) {
+                g_dstar.UpdateCell(x, y);
+            }
+            g_pathCache.OnCellChanged(x, y);
+            g_contractionHierarchiesValid = false;
+            if (lighter) {
+                RequestLandmarkBuild();
+            }
+            g_flowFieldDirty = true;
         }
     }
 
+    bool HasLineOfSight(float x0, float y0, float x1, float y1) {
+        return g_map.HasLineOfSight(x0, y0, x1, y1, GetCornerPolicy(g_diagonalMovement));
+    }
+
+    bool IsReachable(int startX, int startY, int targetX, int targetY) {
+        return g_components.IsReachable(startX, startY, targetX, targetY);
+    }
+
     bool IsObstacle(int x, int y) {
         if (IsInBounds(x, y)) {
-            return g_map[x][y];
+            return g_map.IsBlocked(x, y);
         }
         else {
             return false;
@@ -224,43 +606,226 @@ namespace Pathfinding {
         return g_AStar;
     }
 
+    const ObstacleGrid& GetObstacleGrid() {
+        return g_map;
+    }
+
+    const TerrainCosts& GetTerrainCosts() {
+        return g_terrain;
+    }
+
+    int GetTerrainBrushWeight() {
+        return g_terrainBrushWeights[g_terrainBrush];
+    }
+
+    const JumpDistanceTable& GetJumpDistanceTable() {
+        return g_jumpDistances;
+    }
+
+    MapView GetMapView() {
+        MapView mapView;
+        mapView.grid = &g_map;
+        mapView.jumpDistances = &g_jumpDistances;
+        mapView.landmarks = g_landmarksValid ? &g_landmarks : nullptr;
+        mapView.components = &g_components;
+        mapView.terrain = g_terrain.IsUniform() ? nullptr : &g_terrain;
+        mapView.contractionHierarchy = g_contractionHierarchiesValid ? &g_contractionHierarchies[g_diagonalMovement] : nullptr;
+        return mapView;
+    }
+
+    bool LandmarksReady() {
+        return g_landmarksValid;
+    }
+
+    bool ContractionHierarchyReady() {
+        return g_contractionHierarchiesValid;
+    }
+
+    // Settings picked with the keyboard, for searches driven from Update
+    SearchConfig GetSearchConfig() {
+        SearchConfig config;
+        config.searchMode = g_searchMode;
+        config.diagonalMovement = g_diagonalMovement;
+        config.openList = g_openListType;
+        config.heuristic = g_heuristic;
+        return config;
+    }
+
+    const HierarchicalPathfinder& GetHierarchicalPathfinder() {
+        return g_hpa;
+    }
+
+    const HierarchicalPath& GetHierarchicalPath() {
+        return g_hpaPath;
+    }
+
+    const AnytimeAStar& GetAnytimeAStar() {
+        return g_ara;
+    }
+
+    const DStarLite& GetDStarLite() {
+        return g_dstar;
+    }
+
+    // Rebuilt on first use after the map or target changed, so edits in between cost nothing
+    const FlowField& GetFlowField() {
+        if (g_flowFieldDirty) {
+            g_flowField.Build(g_map, g_target.x, g_target.y, g_diagonalMovement, &g_terrain);
+            g_flowFieldDirty = false;
+        }
+        return g_flowField;
+    }
+
+    // Blocks until every request is solved with the current map and search settings. Requests whose path
+    // hasn't been edited since they were last solved come from the cache, only the rest go to the workers.
+    void FindPaths(const std::vector<PathRequest>& requests, std::vector<PathResult>& results) {
+        if (g_pathWorkers.GetThreadCount() == 0) {
+            g_pathWorkers.Init(std::max(1u, std::thread::hardware_concurrency()));
+        }
+        SearchConfig config = GetSearchConfig();
+        results.resize(requests.size());
+        std::vector<PathRequest> missedRequests;
+        std::vector<int> missedIndices;
+        for (int i = 0; i < requests.size(); i++) {
+            if (!g_pathCache.Find(requests[i], config, results[i])) {
+                missedRequests.push_back(requests[i]);
+                missedIndices.push_back(i);
+            }
+        }
+        std::vector<PathResult> missedResults;
+        g_pathWorkers.FindPaths(GetMapView(), config, missedRequests, missedResults);
+        for (int i = 0; i < missedRequests.size(); i++) {
+            g_pathCache.Store(missedRequests[i], config, missedResults[i]);
+            results[missedIndices[i]] = std::move(missedResults[i]);
+        }
+    }
+
+    const PathCacheStats& GetPathCacheStats() {
+        return g_pathCache.GetStats();
+    }
+
+    bool FlowFieldEnabled() {
+        return g_showFlowField;
+    }
+
     bool SlowModeEnabled() {
         return g_slowMode;
     }
+
+    SearchMode GetSearchMode() {
+        return g_searchMode;
+    }
+
+    DiagonalMovement GetDiagonalMovement() {
+        return g_diagonalMovement;
+    }
+
+    HeuristicType GetHeuristic() {
+        return g_heuristic;
+    }
 }
 
-void AStar::InitSearch(std::vector<std::vector<bool>>& map, int startX, int startY, int destinationX, int destinationY) {
+// Everything the search reads comes from map and config, so separate AStar objects can run on any thread
+// at the same time as long as nobody writes to the map meanwhile.
+void AStar::InitSearch(const MapView& map, const SearchConfig& config, int startX, int startY, int destinationX, int destinationY) {
     ClearData();
-    m_cells.resize(Pathfinding::GetMapWidth(), std::vector<Cell>(Pathfinding::GetMapHeight()));
-    m_openList.AllocateSpace(Pathfinding::GetMapWidth() * Pathfinding::GetMapHeight());
-    m_openList.Clear();
-    for (int x = 0; x < Pathfinding::GetMapWidth(); x++) {
-        for (int y = 0; y < Pathfinding::GetMapHeight(); y++) {
-            m_cells[x][y].x = x;
-            m_cells[x][y].y = y;
-            m_cells[x][y].obstacle = Pathfinding::IsObstacle(x, y);
-            m_cells[x][y].g = 99999;
-            m_cells[x][y].h = -1;
-            m_cells[x][y].f = -1;
-            m_cells[x][y].parent = nullptr;
-            m_cells[x][y].neighbours.clear();
-        }
-    }
-    m_start = &m_cells[startX][startY];
+    m_map = map.grid;
+    m_jumpDistances = map.jumpDistances;
+    m_landmarks = map.landmarks;
+    m_terrain = map.terrain;
+    m_contractionHierarchy = map.contractionHierarchy;
+    m_heuristicScale = m_terrain ? m_terrain->GetMinWeight() : 1;
+    m_bounded = false;
+    m_searchMode = config.searchMode;
+    m_diagonalMovement = config.diagonalMovement;
+    m_heuristic = config.heuristic;
+    // Jumps and any-angle shortcuts assume every cell costs the same to cross
+    if (m_terrain && (m_searchMode == SEARCH_MODE_JPS || m_searchMode == SEARCH_MODE_JPS_PLUS || m_searchMode == SEARCH_MODE_LAZY_THETA)) {
+        m_searchMode = SEARCH_MODE_ASTAR;
+    }
+    // The table only answers for the movement rules it was built with
+    if (m_searchMode == SEARCH_MODE_JPS_PLUS && (!m_jumpDistances || m_jumpDistances->diagonalMovement != m_diagonalMovement || m_jumpDistances->width != m_map->width || m_jumpDistances->height != m_map->height)) {
+        m_searchMode = SEARCH_MODE_JPS;
+    }
+    // Walls have no place in the hierarchy, so a search starting in one has to step out the usual way
+    if (m_searchMode == SEARCH_MODE_CONTRACTION_HIERARCHY && (!m_contractionHierarchy || !m_contractionHierarchy->Matches(m_map->width, m_map->height, m_diagonalMovement) || m_map->IsBlocked(startX, startY))) {
+        m_searchMode = SEARCH_MODE_ASTAR;
+    }
+    // Landmark distances follow grid steps, so they can overestimate any-angle paths
+    if (m_landmarks && (m_searchMode == SEARCH_MODE_LAZY_THETA || !m_landmarks->Matches(m_map->width, m_map->height, m_diagonalMovement))) {
+        m_landmarks = nullptr;
+    }
+    SelectExpandFunction();
+    if (m_nodes.width != m_map->width || m_nodes.height != m_map->height) {
+        m_nodes.Resize(m_map->width, m_map->height);
+    }
+    m_openList.Init(&m_nodes, config.openList);
+    m_nodes.NewGeneration();
+    m_start = m_nodes.GetIndex(startX, startY);
     m_current = m_start;
-    m_destination = &m_cells[destinationX][destinationY];
-    m_start->g = 0;
-    m_start->GetF(m_destination);
+    m_destination = m_nodes.GetIndex(destinationX, destinationY);
+    m_nodes.Touch(m_start);
+    m_nodes.g[m_start] = 0;
+    m_nodes.f[m_start] = GetH(m_start);
+    m_nodes.state[m_start] = NODE_OPEN;
     m_openList.AddItem(m_start);
+    if (m_searchMode == SEARCH_MODE_BIDIRECTIONAL || m_searchMode == SEARCH_MODE_CONTRACTION_HIERARCHY) {
+        if (m_backwardNodes.width != m_nodes.width || m_backwardNodes.height != m_nodes.height) {
+            m_backwardNodes.Resize(m_nodes.width, m_nodes.height);
+        }
+        m_backwardOpenList.Init(&m_backwardNodes, config.openList);
+        m_backwardNodes.NewGeneration();
+        m_backwardNodes.Touch(m_destination);
+        m_backwardNodes.g[m_destination] = 0;
+        m_backwardNodes.f[m_destination] = (m_searchMode == SEARCH_MODE_BIDIRECTIONAL) ? GetDistance(m_destination, m_start) * m_heuristicScale : 0;
+        m_backwardNodes.state[m_destination] = NODE_OPEN;
+        m_backwardOpenList.AddItem(m_destination);
+        if (m_start == m_destination) {
+            m_meetingNode = m_start;
+            m_meetingCost = 0;
+        }
+    }
+    // A target in another component would otherwise only be known unreachable once everything reachable
+    // was expanded. Searches that start inside a wall can still step out, so only open starts are rejected.
+    if (map.components && map.components->Matches(m_map->width, m_map->height, m_diagonalMovement) && !m_map->IsBlocked(startX, startY) &&
+        !map.components->IsReachable(startX, startY, destinationX, destinationY)) {
+        m_openList.Clear();
+        m_backwardOpenList.Clear();
+    }
     m_searchInitilized = true;
 }
 
+// Search that never leaves the given rectangle, used to refine hierarchical paths inside one cluster.
+// Jumps would run straight past the bounds, so this is always plain A*.
+void AStar::InitBoundedSearch(const MapView& map, const SearchConfig& config, int startX, int startY, int destinationX, int destinationY, glm::ivec4 bounds) {
+    SearchConfig boundedConfig = config;
+    boundedConfig.searchMode = SEARCH_MODE_ASTAR;
+    InitSearch(map, boundedConfig, startX, startY, destinationX, destinationY);
+    m_bounds = bounds;
+    m_bounded = true;
+    // InitSearch picked an unbounded kernel
+    SelectExpandFunction();
+}
+
+// Use a path found elsewhere (e.g. the hierarchical pathfinder) as if this search had found it
+void AStar::SetFinalPath(const std::vector<int>& path) {
+    m_openList.Clear();
+    m_finalPath = path;
+    m_gridPathFound = true;
+    InitSmoothPath();
+}
+
 
 void AStar::ClearData() {
     m_closedList.clear();
     m_finalPath.clear();
     m_openList.Clear();
+    m_backwardOpenList.Clear();
     m_intersectionPoints.clear();
+    m_meetingNode = -1;
+    m_meetingCost = INT_MAX;
+    m_forwardExpansions = 0;
+    m_backwardExpansions = 0;
     m_gridPathFound = false;
     m_smoothPathFound = false;
     m_searchInitilized = false;
@@ -279,234 +844,948 @@ bool AStar::SearchInitilized() {
     return m_searchInitilized;
 }
 
-void AStar::FindPath() {
-    if (m_destination->obstacle) {
-        return;
-    }
-    if (m_openList.IsEmpty()) {
-        return;
+// True once FindPath can make no more progress without having found a path
+bool AStar::SearchExhausted() {
+    if (!m_searchInitilized || m_gridPathFound) {
+        return false;
     }
-    if (m_gridPathFound) {
-        return;
+    if (m_map->IsBlocked(m_nodes.GetX(m_destination), m_nodes.GetY(m_destination))) {
+        return true;
     }
-    //while (!m_openList.IsEmpty()
-    {
-        m_current = m_openList.RemoveFirst();
-        if (IsDestination(m_current)) {
-            m_gridPathFound = true;
-            BuildFinalPath();
-            return;
-        }
-        AddIfUnique(&m_closedList, m_current);
-        FindNeighbours(m_current);
-        for (Cell* neighbour : m_current->neighbours) {
-            // Calculate G cost. Equal to parent G cost + 10 if orthogonal and + 14 if diagonal
-            int new_g = IsOrthogonal(m_current, neighbour) ? m_current->g + ORTHOGONAL_COST : m_current->g + DIAGONAL_COST;
-
-            if (IsInClosedList(neighbour) || m_openList.Contains(neighbour)) {
-                // If new G is lower than currently stored value, update it and change parent to the current cell
-                if (new_g < neighbour->g) {
-                    neighbour->g = new_g;
-                    neighbour->f = new_g + neighbour->GetH(m_destination);
-                    neighbour->parent = m_current;
-                }
-            }
-            else {
-                neighbour->g = new_g;
-                neighbour->f = new_g + neighbour->GetH(m_destination);
-                neighbour->parent = m_current;
-
-                if (!m_openList.Contains(neighbour)) {
-                    m_openList.AddItem(neighbour);
-                }
-            }
-        }
+    if (m_searchMode == SEARCH_MODE_BIDIRECTIONAL) {
+        return m_meetingNode == -1 && (m_openList.IsEmpty() || m_backwardOpenList.IsEmpty());
     }
-    if (!Pathfinding::SlowModeEnabled()) {
-        FindPath();
+    if (m_searchMode == SEARCH_MODE_CONTRACTION_HIERARCHY) {
+        return m_meetingNode == -1 && m_openList.IsEmpty() && m_backwardOpenList.IsEmpty();
     }
+    return m_openList.IsEmpty();
 }
 
-MinHeap& AStar::GetOpenList() {
-    return m_openList;
-}
-
-std::list<Cell*>& AStar::GetClosedList() {
-    return m_closedList;
-}
-
-std::vector<Cell*>& AStar::GetPath() {
-    return m_finalPath;
-}
-
-bool AStar::IsDestination(Cell* cell) {
-    return cell == m_destination;
+int AStar::GetPathCost() {
+    if (!m_gridPathFound) {
+        return 0;
+    }
+    return (m_searchMode == SEARCH_MODE_BIDIRECTIONAL || m_searchMode == SEARCH_MODE_CONTRACTION_HIERARCHY) ? m_meetingCost : m_nodes.g[m_destination];
 }
 
-void AStar::BuildFinalPath() {
-    Cell* cell = m_destination;
-    while (cell != m_start) {
-        m_finalPath.push_back(cell);
-        cell = cell->parent;
+SearchStatus AStar::GetStatus() {
+    if (m_gridPathFound) {
+        return SEARCH_FOUND;
     }
-    std::reverse(m_finalPath.begin(), m_finalPath.end());
-
-    // Init smooth search
-    m_smoothPathFound = false;
-    m_smoothSearchIndex = 2;
-    m_intersectionPoints.clear();
-    glm::vec2 startPoint = glm::vec2(m_start->x + 0.5f, m_start->y + 0.5f);
-    glm::vec2 endPoint = glm::vec2(m_destination->x + 0.5f, m_destination->y + 0.5f);
-    m_intersectionPoints.push_back(startPoint);
-    for (int j = 0; j < m_finalPath.size(); j++) {
-        Cell* cell = m_finalPath[j];
-        m_intersectionPoints.push_back(glm::vec2(cell->x, cell->y));
+    if (!m_searchInitilized || SearchExhausted()) {
+        return SEARCH_NO_PATH;
     }
-    m_intersectionPoints.push_back(endPoint);
+    return SEARCH_RUNNING;
 }
 
-bool HasLineOfSight(glm::vec2 startPosition, glm::vec2 endPosition) {
-    float stepSize = 0.5f;
-    glm::vec2 direction = glm::normalize(endPosition - startPosition);
-    glm::vec2 testPosition = startPosition;
-    float distanceToEnd = glm::distance(testPosition, endPosition);
-    float currentDistance = distanceToEnd;
-    while (currentDistance > 1) {
-        testPosition += direction * stepSize;
-        if (Pathfinding::IsObstacle((int)testPosition.x, (int)testPosition.y)) {
-            return false;
+// Expands at most maxExpansions nodes, and stops early once maxMicroseconds have passed if that is set.
+// Long searches can be spread over several frames by calling this once per frame until it isn't running.
+SearchStatus AStar::Step(int maxExpansions, int maxMicroseconds) {
+    std::chrono::steady_clock::time_point startTime;
+    if (maxMicroseconds > 0) {
+        startTime = std::chrono::steady_clock::now();
+    }
+    for (int i = 0; i < maxExpansions; i++) {
+        if (GetStatus() != SEARCH_RUNNING) {
+            break;
         }
-        currentDistance = glm::distance(testPosition, endPosition);
-        // You made it past your target! There is line of sight
-        if (currentDistance > distanceToEnd) {
-            return true;
+        if (!(this->*m_expand)()) {
+            break;
+        }
+        if (maxMicroseconds > 0 && i % SEARCH_CLOCK_INTERVAL == SEARCH_CLOCK_INTERVAL - 1) {
+            auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime);
+            if (elapsed.count() >= maxMicroseconds) {
+                break;
+            }
         }
     }
-    return true;
+    return GetStatus();
 }
 
-void AStar::FindSmoothPath() {
-    if (!m_gridPathFound) {
-        return;
-    }
-    if (m_smoothSearchIndex >= m_intersectionPoints.size()) {
-        m_smoothPathFound = true;
+// Runs the search to the end
+void AStar::FindPath() {
+    Step(INT_MAX);
+}
+
+// Plain A* gets a kernel built for its movement rules, heuristic and extras. The other modes have enough
+// per-node work of their own that the generic expansion costs them little.
+void AStar::SelectExpandFunction() {
+    using KernelSelector = ExpandFunction (AStar::*)() const;
+    static const KernelSelector kernels[DIAGONAL_MOVEMENT_COUNT][HEURISTIC_TYPE_COUNT] = {
+        { &AStar::SelectKernel<FourConnected, OctileHeuristic>, &AStar::SelectKernel<FourConnected, ManhattanHeuristic>, &AStar::SelectKernel<FourConnected, EuclideanHeuristic> },
+        { &AStar::SelectKernel<NoCornerCutting, OctileHeuristic>, &AStar::SelectKernel<NoCornerCutting, ManhattanHeuristic>, &AStar::SelectKernel<NoCornerCutting, EuclideanHeuristic> },
+        { &AStar::SelectKernel<CornerCutting, OctileHeuristic>, &AStar::SelectKernel<CornerCutting, ManhattanHeuristic>, &AStar::SelectKernel<CornerCutting, EuclideanHeuristic> },
+    };
+    if (m_searchMode == SEARCH_MODE_BIDIRECTIONAL) {
+        m_expand = &AStar::ExpandBidirectional;
     }
-    if (m_smoothPathFound) {
-        return;
+    else if (m_searchMode == SEARCH_MODE_CONTRACTION_HIERARCHY) {
+        m_expand = &AStar::ExpandContractionHierarchy;
     }
-    // Remove points with line of sight
-    glm::vec2 currentPosition = m_intersectionPoints[m_smoothSearchIndex];
-    glm::vec2 queryPosition = m_intersectionPoints[m_smoothSearchIndex -2];
-    glm::vec2 intersectionPointOut;
-    if (HasLineOfSight(currentPosition, queryPosition)) {
-        m_intersectionPoints.erase(m_intersectionPoints.begin() + m_smoothSearchIndex - 1);
+    else if (m_searchMode == SEARCH_MODE_ASTAR) {
+        m_expand = (this->*kernels[m_diagonalMovement][m_heuristic])();
     }
     else {
-        m_smoothSearchIndex++;
-    }
-    if (!Pathfinding::SlowModeEnabled()) {
-        FindSmoothPath();
-    }
-}
-
-void AStar::AddIfUnique(std::list<Cell*>* list, Cell* cell) {
-    std::list<Cell*>::iterator it;
-    it = std::find(list->begin(), list->end(), cell);
-    if (it == list->end()) {
-        list->push_front(cell);
+        m_expand = &AStar::Expand;
     }
 }
 
-bool AStar::IsOrthogonal(Cell* cellA, Cell* cellB) {
-    return (cellA->x == cellB->x || cellA->y == cellB->y);
-}
-
-bool AStar::IsInClosedList(Cell* cell) {
-    std::list<Cell*>::iterator it;
-    it = std::find(m_closedList.begin(), m_closedList.end(), cell);
-    return (it != m_closedList.end());
+// The kernel for this search's terrain, landmarks and bounds
+template <typename Connectivity, typename Heuristic>
+AStar::ExpandFunction AStar::SelectKernel() const {
+    static const ExpandFunction kernels[2][2][2] = {
+        {
+            { &AStar::ExpandKernel<Connectivity, Heuristic, SearchFeatures<false, false, false>>, &AStar::ExpandKernel<Connectivity, Heuristic, SearchFeatures<false, false, true>> },
+            { &AStar::ExpandKernel<Connectivity, Heuristic, SearchFeatures<false, true, false>>, &AStar::ExpandKernel<Connectivity, Heuristic, SearchFeatures<false, true, true>> },
+        },
+        {
+            { &AStar::ExpandKernel<Connectivity, Heuristic, SearchFeatures<true, false, false>>, &AStar::ExpandKernel<Connectivity, Heuristic, SearchFeatures<true, false, true>> },
+            { &AStar::ExpandKernel<Connectivity, Heuristic, SearchFeatures<true, true, false>>, &AStar::ExpandKernel<Connectivity, Heuristic, SearchFeatures<true, true, true>> },
+        },
+    };
+    return kernels[m_terrain != nullptr][m_landmarks != nullptr][m_bounded];
 }
 
-void AStar::FindNeighbours(Cell* cell) {
-    if (m_current->neighbours.size() != 0) {
-        return;
+// One A* expansion with the movement rules, heuristic and extras fixed at compile time. Returns false when the search is over.
+template <typename Connectivity, typename Heuristic, typename Features>
+bool AStar::ExpandKernel() {
+    m_current = m_openList.RemoveFirst();
+    if (IsDestination(m_current)) {
+        m_gridPathFound = true;
+        BuildFinalPath();
+        return false;
     }
-    int x = cell->x;
-    int y = cell->y;
-    // North
-    if (Pathfinding::IsInBounds(x, y - 1) && !Pathfinding::IsObstacle(x, y - 1)) {
-        m_cells[x][y].neighbours.push_back(&m_cells[x][y - 1]);
-    }
-    // South
-    if (Pathfinding::IsInBounds(x, y + 1) && !Pathfinding::IsObstacle(x, y + 1)) {
-        m_cells[x][y].neighbours.push_back(&m_cells[x][y + 1]);
+    m_nodes.state[m_current] = NODE_CLOSED;
+    m_closedList.push_back(m_current);
+    m_forwardExpansions++;
+    int neighbours[8];
+    int neighbourCount = FindNeighbours<Connectivity>(m_current, neighbours);
+    if constexpr (Features::bounded) {
+        neighbourCount = ClipToBounds(neighbours, neighbourCount);
     }
-    // West
-    if (Pathfinding::IsInBounds(x - 1, y) && !Pathfinding::IsObstacle(x - 1, y)) {
-        m_cells[x][y].neighbours.push_back(&m_cells[x - 1][y]);
+    int currentG = m_nodes.g[m_current];
+    for (int i = 0; i < neighbourCount; i++) {
+        int neighbour = neighbours[i];
+        m_nodes.Touch(neighbour);
+        if (m_nodes.state[neighbour] == NODE_CLOSED) {
+            continue;
+        }
+        int offset = std::abs(neighbour - m_current);
+        int stepCost = (!Connectivity::diagonal || offset == 1 || offset == m_nodes.width) ? ORTHOGONAL_COST : DIAGONAL_COST;
+        if constexpr (Features::terrain) {
+            stepCost = m_terrain->GetStepCost(m_current, neighbour, stepCost);
+        }
+        int new_g = currentG + stepCost;
+        if (m_nodes.state[neighbour] == NODE_OPEN) {
+            if (new_g < m_nodes.g[neighbour]) {
+                m_nodes.g[neighbour] = new_g;
+                m_nodes.f[neighbour] = new_g + GetH<Heuristic, Features::landmarks>(neighbour);
+                m_nodes.parent[neighbour] = m_current;
+                m_openList.Update(neighbour);
+            }
+        }
+        else {
+            m_nodes.g[neighbour] = new_g;
+            m_nodes.f[neighbour] = new_g + GetH<Heuristic, Features::landmarks>(neighbour);
+            m_nodes.parent[neighbour] = m_current;
+            m_nodes.state[neighbour] = NODE_OPEN;
+            m_openList.AddItem(neighbour);
+        }
     }
-    // East
-    if (Pathfinding::IsInBounds(x + 1, y) && !Pathfinding::IsObstacle(x + 1, y)) {
-        m_cells[x][y].neighbours.push_back(&m_cells[x + 1][y]);
+    return !m_openList.IsEmpty();
+}
+
+// One expansion of the modes without their own kernel. Returns false when the search is over.
+bool AStar::Expand() {
+    m_current = m_openList.RemoveFirst();
+    if (m_searchMode == SEARCH_MODE_LAZY_THETA) {
+        SetVertex(m_current);
     }
-    /*
-    // North West
-    if (Pathfinding::IsInBounds(x - 1, y - 1) && !Pathfinding::IsObstacle(x - 1, y - 1)) {// && !Pathfinding::IsObstacle(x - 1, y) && !Pathfinding::IsObstacle(x, y - 1)) {
-        m_cells[x][y].neighbours.push_back(&m_cells[x - 1][y - 1]);
+    if (IsDestination(m_current)) {
+        m_gridPathFound = true;
+        BuildFinalPath();
+        return false;
     }
-    // North East
-    if (Pathfinding::IsInBounds(x + 1, y - 1) && !Pathfinding::IsObstacle(x + 1, y - 1)) {// && !Pathfinding::IsObstacle(x + 1, y) && !Pathfinding::IsObstacle(x, y - 1)) {
-        m_cells[x][y].neighbours.push_back(&m_cells[x + 1][y - 1]);
+    m_nodes.state[m_current] = NODE_CLOSED;
+    m_closedList.push_back(m_current);
+    m_forwardExpansions++;
+    int neighbours[8];
+    int neighbourCount = 0;
+    if (m_searchMode == SEARCH_MODE_JPS) {
+        neighbourCount = FindJumpPoints(m_current, neighbours);
     }
-    // South West
-    if (Pathfinding::IsInBounds(x - 1, y + 1) && !Pathfinding::IsObstacle(x - 1, y + 1)) {// && !Pathfinding::IsObstacle(x - 1, y) && !Pathfinding::IsObstacle(x, y + 1)) {
-        m_cells[x][y].neighbours.push_back(&m_cells[x - 1][y + 1]);
+    else if (m_searchMode == SEARCH_MODE_JPS_PLUS) {
+        neighbourCount = FindJumpPointsFromTable(m_current, neighbours);
     }
-    // South East
-    if (Pathfinding::IsInBounds(x + 1, y + 1) && !Pathfinding::IsObstacle(x + 1, y + 1)) {// && !Pathfinding::IsObstacle(x + 1, y) && !Pathfinding::IsObstacle(x, y + 1)) {
-        m_cells[x][y].neighbours.push_back(&m_cells[x + 1][y + 1]);
-    }*/
-}
-
-float Cell::GetF(Cell* destination) {
-    if (f == -1) {
-        f = g + GetH(destination);
+    else {
+        neighbourCount = FindNeighbours(m_current, neighbours);
     }
-    return f;
-}
-
-float Cell::GetH(Cell* destination) {
-    if (h == -1) {
-        int dstX = std::abs(x - destination->x);
-        int dstY = std::abs(y - destination->y);
-        if (dstX > dstY) {
-            h = DIAGONAL_COST * dstY + ORTHOGONAL_COST * (dstX - dstY);
+    for (int i = 0; i < neighbourCount; i++) {
+        int neighbour = neighbours[i];
+        m_nodes.Touch(neighbour);
+        if (m_nodes.state[neighbour] == NODE_CLOSED) {
+            continue;
+        }
+        int parent = m_current;
+        int new_g = 0;
+        if (m_searchMode == SEARCH_MODE_LAZY_THETA) {
+            // Lazy Theta* assumes the grandparent can see the neighbour and only checks once it is expanded.
+            // Its costs are straight line distances throughout, matching its heuristic.
+            if (m_nodes.parent[m_current] != -1) {
+                parent = m_nodes.parent[m_current];
+            }
+            new_g = m_nodes.g[parent] + GetEuclideanDistance(parent, neighbour);
         }
         else {
-            h = DIAGONAL_COST * dstX + ORTHOGONAL_COST * (dstY - dstX);
+            // Parent G cost + 10 per orthogonal step and + 14 per diagonal step
+            new_g = m_nodes.g[m_current] + GetStepCost(m_current, neighbour);
+        }
+
+        if (m_nodes.state[neighbour] == NODE_OPEN) {
+            // If new G is lower than currently stored value, update it and change parent
+            if (new_g < m_nodes.g[neighbour]) {
+                m_nodes.g[neighbour] = new_g;
+                m_nodes.f[neighbour] = new_g + GetH(neighbour);
+                m_nodes.parent[neighbour] = parent;
+                m_openList.Update(neighbour);
+            }
+        }
+        else {
+            m_nodes.g[neighbour] = new_g;
+            m_nodes.f[neighbour] = new_g + GetH(neighbour);
+            m_nodes.parent[neighbour] = parent;
+            m_nodes.state[neighbour] = NODE_OPEN;
+            m_openList.AddItem(neighbour);
+        }
+    }
+    return !m_openList.IsEmpty();
+}
+
+// One expansion of bidirectional A*, from whichever side has the smaller open list. Both heuristics are
+// consistent, so the best meeting cost is optimal once no open node in either direction has a lower f.
+// Returns false when the search is over.
+bool AStar::ExpandBidirectional() {
+    if (m_openList.IsEmpty() || m_backwardOpenList.IsEmpty()) {
+        // One side ran out, so every path it could have found was already seen by the other
+        if (m_meetingNode != -1) {
+            m_gridPathFound = true;
+            BuildFinalPath();
+        }
+        return false;
+    }
+    int forwardMinF = m_nodes.f[m_openList.PeekFirst()];
+    int backwardMinF = m_backwardNodes.f[m_backwardOpenList.PeekFirst()];
+    if (m_meetingNode != -1 && m_meetingCost <= std::max(forwardMinF, backwardMinF)) {
+        m_gridPathFound = true;
+        BuildFinalPath();
+        return false;
+    }
+    bool forward = m_openList.Size() <= m_backwardOpenList.Size();
+    NodeStore& nodes = forward ? m_nodes : m_backwardNodes;
+    NodeStore& otherNodes = forward ? m_backwardNodes : m_nodes;
+    OpenList& openList = forward ? m_openList : m_backwardOpenList;
+    int goal = forward ? m_destination : m_start;
+
+    m_current = openList.RemoveFirst();
+    nodes.state[m_current] = NODE_CLOSED;
+    m_closedList.push_back(m_current);
+    if (forward) {
+        m_forwardExpansions++;
+    }
+    else {
+        m_backwardExpansions++;
+    }
+    // Steps are symmetric, so the backward search can use the same neighbours
+    int neighbours[8];
+    int neighbourCount = FindNeighbours(m_current, neighbours);
+    for (int i = 0; i < neighbourCount; i++) {
+        int neighbour = neighbours[i];
+        nodes.Touch(neighbour);
+        if (nodes.state[neighbour] == NODE_CLOSED) {
+            continue;
+        }
+        int new_g = nodes.g[m_current] + GetStepCost(m_current, neighbour);
+        if (nodes.state[neighbour] == NODE_OPEN) {
+            if (new_g >= nodes.g[neighbour]) {
+                continue;
+            }
+            nodes.g[neighbour] = new_g;
+            nodes.f[neighbour] = new_g + GetDistance(neighbour, goal) * m_heuristicScale;
+            nodes.parent[neighbour] = m_current;
+            openList.Update(neighbour);
+        }
+        else {
+            nodes.g[neighbour] = new_g;
+            nodes.f[neighbour] = new_g + GetDistance(neighbour, goal) * m_heuristicScale;
+            nodes.parent[neighbour] = m_current;
+            nodes.state[neighbour] = NODE_OPEN;
+            openList.AddItem(neighbour);
+        }
+        otherNodes.Touch(neighbour);
+        if (otherNodes.state[neighbour] != NODE_UNVISITED && new_g + otherNodes.g[neighbour] < m_meetingCost) {
+            m_meetingCost = new_g + otherNodes.g[neighbour];
+            m_meetingNode = neighbour;
+        }
+    }
+    return true;
+}
+
+// One settle of the contraction hierarchy query, from whichever side has the lower g. Both sides only climb
+// to higher ranks, so reaching the other side's start proves nothing and they run until neither has an
+// open node cheaper than the best meeting. Returns false when the search is over.
+bool AStar::ExpandContractionHierarchy() {
+    int forwardMinG = m_openList.IsEmpty() ? INT_MAX : m_nodes.g[m_openList.PeekFirst()];
+    int backwardMinG = m_backwardOpenList.IsEmpty() ? INT_MAX : m_backwardNodes.g[m_backwardOpenList.PeekFirst()];
+    if (std::min(forwardMinG, backwardMinG) >= m_meetingCost) {
+        if (m_meetingNode != -1) {
+            m_gridPathFound = true;
+            BuildFinalPath();
+        }
+        return false;
+    }
+    bool forward = forwardMinG <= backwardMinG;
+    NodeStore& nodes = forward ? m_nodes : m_backwardNodes;
+    NodeStore& otherNodes = forward ? m_backwardNodes : m_nodes;
+    OpenList& openList = forward ? m_openList : m_backwardOpenList;
+
+    m_current = openList.RemoveFirst();
+    nodes.state[m_current] = NODE_CLOSED;
+    m_closedList.push_back(m_current);
+    if (forward) {
+        m_forwardExpansions++;
+    }
+    else {
+        m_backwardExpansions++;
+    }
+    const ContractionHierarchy& hierarchy = *m_contractionHierarchy;
+    int firstEdge = hierarchy.firstEdge[m_current];
+    int lastEdge = hierarchy.firstEdge[m_current + 1];
+    // Steps are symmetric, so these edges also lead down here from above. If this side already reached one of
+    // those cells and that is a cheaper way here, no shortest path goes on from this cell.
+    for (int i = firstEdge; i < lastEdge; i++) {
+        const ContractionEdge& edge = hierarchy.edges[i];
+        nodes.Touch(edge.to);
+        if (nodes.state[edge.to] != NODE_UNVISITED && nodes.g[edge.to] + edge.cost < nodes.g[m_current]) {
+            return true;
+        }
+    }
+    for (int i = firstEdge; i < lastEdge; i++) {
+        const ContractionEdge& edge = hierarchy.edges[i];
+        int new_g = nodes.g[m_current] + edge.cost;
+        if (nodes.state[edge.to] == NODE_CLOSED || new_g >= nodes.g[edge.to]) {
+            continue;
+        }
+        nodes.g[edge.to] = new_g;
+        nodes.f[edge.to] = new_g;
+        nodes.parent[edge.to] = m_current;
+        if (nodes.state[edge.to] == NODE_OPEN) {
+            openList.Update(edge.to);
+        }
+        else {
+            nodes.state[edge.to] = NODE_OPEN;
+            openList.AddItem(edge.to);
+        }
+        otherNodes.Touch(edge.to);
+        if (otherNodes.state[edge.to] != NODE_UNVISITED && new_g + otherNodes.g[edge.to] < m_meetingCost) {
+            m_meetingCost = new_g + otherNodes.g[edge.to];
+            m_meetingNode = edge.to;
+        }
+    }
+    return true;
+}
+
+OpenList& AStar::GetOpenList() {
+    return m_openList;
+}
+
+OpenList& AStar::GetBackwardOpenList() {
+    return m_backwardOpenList;
+}
+
+int AStar::GetForwardExpansions() {
+    return m_forwardExpansions;
+}
+
+int AStar::GetBackwardExpansions() {
+    return m_backwardExpansions;
+}
+
+std::vector<int>& AStar::GetClosedList() {
+    return m_closedList;
+}
+
+std::vector<int>& AStar::GetPath() {
+    return m_finalPath;
+}
+
+NodeStore& AStar::GetNodes() {
+    return m_nodes;
+}
+
+bool AStar::IsDestination(int index) {
+    return index == m_destination;
+}
+
+void AStar::BuildFinalPath() {
+    if (m_searchMode == SEARCH_MODE_LAZY_THETA) {
+        // Any-angle paths are already taut, so the path is just the turning points and needs no smoothing
+        for (int index = m_destination; index != m_start; index = m_nodes.parent[index]) {
+            m_finalPath.push_back(index);
+        }
+        std::reverse(m_finalPath.begin(), m_finalPath.end());
+        m_intersectionPoints.clear();
+        m_intersectionPoints.push_back(glm::vec2(m_nodes.GetX(m_start) + 0.5f, m_nodes.GetY(m_start) + 0.5f));
+        for (int index : m_finalPath) {
+            m_intersectionPoints.push_back(glm::vec2(m_nodes.GetX(index) + 0.5f, m_nodes.GetY(index) + 0.5f));
+        }
+        m_smoothSearchIndex = (int)m_intersectionPoints.size();
+        m_smoothPathFound = true;
+        return;
+    }
+    if (m_searchMode == SEARCH_MODE_BIDIRECTIONAL) {
+        // Forward parents lead back to the start, backward parents lead on to the destination
+        for (int index = m_meetingNode; index != m_start; index = m_nodes.parent[index]) {
+            m_finalPath.push_back(index);
+        }
+        std::reverse(m_finalPath.begin(), m_finalPath.end());
+        for (int index = m_meetingNode; index != m_destination; ) {
+            index = m_backwardNodes.parent[index];
+            m_finalPath.push_back(index);
+        }
+        InitSmoothPath();
+        return;
+    }
+    if (m_searchMode == SEARCH_MODE_CONTRACTION_HIERARCHY) {
+        // The parents on both sides are hierarchy edges, each unpacked back into the grid steps it stands for
+        std::vector<int> nodes;
+        for (int index = m_meetingNode; index != m_start; index = m_nodes.parent[index]) {
+            nodes.push_back(index);
+        }
+        nodes.push_back(m_start);
+        std::reverse(nodes.begin(), nodes.end());
+        for (int index = m_meetingNode; index != m_destination; ) {
+            index = m_backwardNodes.parent[index];
+            nodes.push_back(index);
+        }
+        for (int i = 1; i < (int)nodes.size(); i++) {
+            // Only a damaged hierarchy can lack an edge it searched over, and then there is no path to give
+            if (!m_contractionHierarchy->Unpack(nodes[i - 1], nodes[i], m_finalPath)) {
+                m_finalPath.clear();
+                m_gridPathFound = false;
+                m_meetingNode = -1;
+                m_openList.Clear();
+                m_backwardOpenList.Clear();
+                return;
+            }
+        }
+        InitSmoothPath();
+        return;
+    }
+    int index = m_destination;
+    while (index != m_start) {
+        // Jump points can be several cells from their parent, so walk back one cell at a time
+        int parent = m_nodes.parent[index];
+        int x = m_nodes.GetX(index);
+        int y = m_nodes.GetY(index);
+        int stepX = glm::sign(m_nodes.GetX(parent) - x);
+        int stepY = glm::sign(m_nodes.GetY(parent) - y);
+        while (index != parent) {
+            m_finalPath.push_back(index);
+            x += stepX;
+            y += stepY;
+            index = m_nodes.GetIndex(x, y);
+        }
+    }
+    std::reverse(m_finalPath.begin(), m_finalPath.end());
+    InitSmoothPath();
+}
+
+void AStar::InitSmoothPath() {
+    m_smoothPathFound = false;
+    m_smoothSearchIndex = 2;
+    m_intersectionPoints.clear();
+    glm::vec2 startPoint = glm::vec2(m_nodes.GetX(m_start) + 0.5f, m_nodes.GetY(m_start) + 0.5f);
+    glm::vec2 endPoint = glm::vec2(m_nodes.GetX(m_destination) + 0.5f, m_nodes.GetY(m_destination) + 0.5f);
+    m_intersectionPoints.push_back(startPoint);
+    for (int j = 0; j < m_finalPath.size(); j++) {
+        int index = m_finalPath[j];
+        m_intersectionPoints.push_back(glm::vec2(m_nodes.GetX(index), m_nodes.GetY(index)));
+    }
+    m_intersectionPoints.push_back(endPoint);
+}
+
+// Does at most maxSteps line of sight tests
+void AStar::FindSmoothPath(int maxSteps) {
+    if (!m_gridPathFound) {
+        return;
+    }
+    for (int i = 0; i < maxSteps && !m_smoothPathFound; i++) {
+        if (m_smoothSearchIndex >= m_intersectionPoints.size()) {
+            m_smoothPathFound = true;
+            break;
+        }
+        // Remove points with line of sight
+        glm::vec2 currentPosition = m_intersectionPoints[m_smoothSearchIndex];
+        glm::vec2 queryPosition = m_intersectionPoints[m_smoothSearchIndex -2];
+        if (m_map->HasLineOfSight(queryPosition.x, queryPosition.y, currentPosition.x, currentPosition.y, GetCornerPolicy(m_diagonalMovement))) {
+            m_intersectionPoints.erase(m_intersectionPoints.begin() + m_smoothSearchIndex - 1);
+        }
+        else {
+            m_smoothSearchIndex++;
         }
     }
+}
+
+bool AStar::IsInClosedList(int index) {
+    return m_nodes.state[index] == NODE_CLOSED;
+}
+
+// Lazy Theta* expansion step. If the assumed parent can't actually see this node, fall back to the
+// best already expanded neighbour, which is always a valid grid step.
+void AStar::SetVertex(int index) {
+    int parent = m_nodes.parent[index];
+    if (parent == -1 || m_map->HasLineOfSight(m_nodes.GetX(parent) + 0.5f, m_nodes.GetY(parent) + 0.5f, m_nodes.GetX(index) + 0.5f, m_nodes.GetY(index) + 0.5f, GetCornerPolicy(m_diagonalMovement))) {
+        return;
+    }
+    int neighbours[8];
+    int neighbourCount = FindNeighbours(index, neighbours);
+    m_nodes.g[index] = INT_MAX;
+    for (int i = 0; i < neighbourCount; i++) {
+        int neighbour = neighbours[i];
+        m_nodes.Touch(neighbour);
+        if (m_nodes.state[neighbour] != NODE_CLOSED) {
+            continue;
+        }
+        int g = m_nodes.g[neighbour] + GetEuclideanDistance(neighbour, index);
+        if (g < m_nodes.g[index]) {
+            m_nodes.g[index] = g;
+            m_nodes.parent[index] = neighbour;
+        }
+    }
+}
+
+int AStar::FindNeighbours(int index, int* neighbours) {
+    int count = 0;
+    switch (m_diagonalMovement) {
+        case DIAGONAL_NO_CORNER_CUTTING: count = FindNeighbours<NoCornerCutting>(index, neighbours); break;
+        case DIAGONAL_CORNER_CUTTING: count = FindNeighbours<CornerCutting>(index, neighbours); break;
+        default: count = FindNeighbours<FourConnected>(index, neighbours); break;
+    }
+    if (m_bounded) {
+        count = ClipToBounds(neighbours, count);
+    }
+    return count;
+}
+
+template <typename Connectivity>
+int AStar::FindNeighbours(int index, int* neighbours) {
+    int x = m_nodes.GetX(index);
+    int y = m_nodes.GetY(index);
+    int count = 0;
+    // The grid border is padded with blocked cells, so no bounds checks are needed
+    uint32_t blocked = m_map->GetNeighbourhood(x, y);
+    // North
+    if (!(blocked & (1 << 1))) {
+        neighbours[count++] = index - m_nodes.width;
+    }
+    // South
+    if (!(blocked & (1 << 7))) {
+        neighbours[count++] = index + m_nodes.width;
+    }
+    // West
+    if (!(blocked & (1 << 3))) {
+        neighbours[count++] = index - 1;
+    }
+    // East
+    if (!(blocked & (1 << 5))) {
+        neighbours[count++] = index + 1;
+    }
+    if constexpr (Connectivity::diagonal) {
+        // North West
+        if (!(blocked & (1 << 0)) && Connectivity::CanMoveDiagonally(blocked & (1 << 3), blocked & (1 << 1))) {
+            neighbours[count++] = index - m_nodes.width - 1;
+        }
+        // North East
+        if (!(blocked & (1 << 2)) && Connectivity::CanMoveDiagonally(blocked & (1 << 5), blocked & (1 << 1))) {
+            neighbours[count++] = index - m_nodes.width + 1;
+        }
+        // South West
+        if (!(blocked & (1 << 6)) && Connectivity::CanMoveDiagonally(blocked & (1 << 3), blocked & (1 << 7))) {
+            neighbours[count++] = index + m_nodes.width - 1;
+        }
+        // South East
+        if (!(blocked & (1 << 8)) && Connectivity::CanMoveDiagonally(blocked & (1 << 5), blocked & (1 << 7))) {
+            neighbours[count++] = index + m_nodes.width + 1;
+        }
+    }
+    return count;
+}
+
+// Drops the neighbours outside the bounds of a bounded search, returns how many are left
+int AStar::ClipToBounds(int* neighbours, int count) {
+    int boundedCount = 0;
+    for (int i = 0; i < count; i++) {
+        int neighbourX = m_nodes.GetX(neighbours[i]);
+        int neighbourY = m_nodes.GetY(neighbours[i]);
+        if (neighbourX >= m_bounds.x && neighbourY >= m_bounds.y && neighbourX <= m_bounds.z && neighbourY <= m_bounds.w) {
+            neighbours[boundedCount++] = neighbours[i];
+        }
+    }
+    return boundedCount;
+}
+
+bool AStar::IsWalkable(int x, int y) {
+    return !m_map->IsBlocked(x, y);
+}
+
+int AStar::FindPrunedNeighbours(int index, int* neighbours) {
+    int parent = m_nodes.parent[index];
+    if (parent == -1) {
+        return FindNeighbours(index, neighbours);
+    }
+    int x = m_nodes.GetX(index);
+    int y = m_nodes.GetY(index);
+    int dx = glm::sign(x - m_nodes.GetX(parent));
+    int dy = glm::sign(y - m_nodes.GetY(parent));
+    int count = 0;
+    if (m_diagonalMovement == DIAGONAL_NEVER) {
+        if (dx != 0) {
+            if (IsWalkable(x, y - 1)) neighbours[count++] = m_nodes.GetIndex(x, y - 1);
+            if (IsWalkable(x, y + 1)) neighbours[count++] = m_nodes.GetIndex(x, y + 1);
+            if (IsWalkable(x + dx, y)) neighbours[count++] = m_nodes.GetIndex(x + dx, y);
+        }
+        else {
+            if (IsWalkable(x - 1, y)) neighbours[count++] = m_nodes.GetIndex(x - 1, y);
+            if (IsWalkable(x + 1, y)) neighbours[count++] = m_nodes.GetIndex(x + 1, y);
+            if (IsWalkable(x, y + dy)) neighbours[count++] = m_nodes.GetIndex(x, y + dy);
+        }
+    }
+    else if (m_diagonalMovement == DIAGONAL_NO_CORNER_CUTTING) {
+        if (dx != 0 && dy != 0) {
+            bool walkableX = IsWalkable(x + dx, y);
+            bool walkableY = IsWalkable(x, y + dy);
+            if (walkableY) neighbours[count++] = m_nodes.GetIndex(x, y + dy);
+            if (walkableX) neighbours[count++] = m_nodes.GetIndex(x + dx, y);
+            if (walkableX && walkableY && IsWalkable(x + dx, y + dy)) neighbours[count++] = m_nodes.GetIndex(x + dx, y + dy);
+        }
+        else if (dx != 0) {
+            bool walkableNext = IsWalkable(x + dx, y);
+            bool walkableUp = IsWalkable(x, y - 1);
+            bool walkableDown = IsWalkable(x, y + 1);
+            if (walkableNext) {
+                neighbours[count++] = m_nodes.GetIndex(x + dx, y);
+                if (walkableUp && IsWalkable(x + dx, y - 1)) neighbours[count++] = m_nodes.GetIndex(x + dx, y - 1);
+                if (walkableDown && IsWalkable(x + dx, y + 1)) neighbours[count++] = m_nodes.GetIndex(x + dx, y + 1);
+            }
+            if (walkableUp) neighbours[count++] = m_nodes.GetIndex(x, y - 1);
+            if (walkableDown) neighbours[count++] = m_nodes.GetIndex(x, y + 1);
+        }
+        else {
+            bool walkableNext = IsWalkable(x, y + dy);
+            bool walkableLeft = IsWalkable(x - 1, y);
+            bool walkableRight = IsWalkable(x + 1, y);
+            if (walkableNext) {
+                neighbours[count++] = m_nodes.GetIndex(x, y + dy);
+                if (walkableLeft && IsWalkable(x - 1, y + dy)) neighbours[count++] = m_nodes.GetIndex(x - 1, y + dy);
+                if (walkableRight && IsWalkable(x + 1, y + dy)) neighbours[count++] = m_nodes.GetIndex(x + 1, y + dy);
+            }
+            if (walkableLeft) neighbours[count++] = m_nodes.GetIndex(x - 1, y);
+            if (walkableRight) neighbours[count++] = m_nodes.GetIndex(x + 1, y);
+        }
+    }
+    else {
+        if (dx != 0 && dy != 0) {
+            bool walkableX = IsWalkable(x + dx, y);
+            bool walkableY = IsWalkable(x, y + dy);
+            if (walkableY) neighbours[count++] = m_nodes.GetIndex(x, y + dy);
+            if (walkableX) neighbours[count++] = m_nodes.GetIndex(x + dx, y);
+            if ((walkableX || walkableY) && IsWalkable(x + dx, y + dy)) neighbours[count++] = m_nodes.GetIndex(x + dx, y + dy);
+            // Forced neighbours
+            if (!IsWalkable(x - dx, y) && walkableY && IsWalkable(x - dx, y + dy)) neighbours[count++] = m_nodes.GetIndex(x - dx, y + dy);
+            if (!IsWalkable(x, y - dy) && walkableX && IsWalkable(x + dx, y - dy)) neighbours[count++] = m_nodes.GetIndex(x + dx, y - dy);
+        }
+        else if (dx != 0) {
+            if (IsWalkable(x + dx, y)) {
+                neighbours[count++] = m_nodes.GetIndex(x + dx, y);
+                // Forced neighbours
+                if (!IsWalkable(x, y - 1) && IsWalkable(x + dx, y - 1)) neighbours[count++] = m_nodes.GetIndex(x + dx, y - 1);
+                if (!IsWalkable(x, y + 1) && IsWalkable(x + dx, y + 1)) neighbours[count++] = m_nodes.GetIndex(x + dx, y + 1);
+            }
+        }
+        else {
+            if (IsWalkable(x, y + dy)) {
+                neighbours[count++] = m_nodes.GetIndex(x, y + dy);
+                // Forced neighbours
+                if (!IsWalkable(x - 1, y) && IsWalkable(x - 1, y + dy)) neighbours[count++] = m_nodes.GetIndex(x - 1, y + dy);
+                if (!IsWalkable(x + 1, y) && IsWalkable(x + 1, y + dy)) neighbours[count++] = m_nodes.GetIndex(x + 1, y + dy);
+            }
+        }
+    }
+    return count;
+}
+
+int AStar::FindJumpPoints(int index, int* jumpPoints) {
+    int x = m_nodes.GetX(index);
+    int y = m_nodes.GetY(index);
+    int neighbours[8];
+    int neighbourCount = FindPrunedNeighbours(index, neighbours);
+    int count = 0;
+    for (int i = 0; i < neighbourCount; i++) {
+        int neighbourX = m_nodes.GetX(neighbours[i]);
+        int neighbourY = m_nodes.GetY(neighbours[i]);
+        int jumpPoint = Jump(neighbourX, neighbourY, neighbourX - x, neighbourY - y);
+        if (jumpPoint != -1) {
+            jumpPoints[count++] = jumpPoint;
+        }
+    }
+    return count;
+}
+
+// Walks from x, y in direction dx, dy until it finds a cell worth adding to the open list. Returns -1 if it hits a wall first.
+int AStar::Jump(int x, int y, int dx, int dy) {
+    int destinationX = m_nodes.GetX(m_destination);
+    int destinationY = m_nodes.GetY(m_destination);
+    while (true) {
+        if (!IsWalkable(x, y)) {
+            return -1;
+        }
+        if (x == destinationX && y == destinationY) {
+            return m_nodes.GetIndex(x, y);
+        }
+        if (m_diagonalMovement == DIAGONAL_NEVER) {
+            if (dx != 0) {
+                if ((IsWalkable(x, y - 1) && !IsWalkable(x - dx, y - 1)) || (IsWalkable(x, y + 1) && !IsWalkable(x - dx, y + 1))) {
+                    return m_nodes.GetIndex(x, y);
+                }
+            }
+            else {
+                if ((IsWalkable(x - 1, y) && !IsWalkable(x - 1, y - dy)) || (IsWalkable(x + 1, y) && !IsWalkable(x + 1, y - dy))) {
+                    return m_nodes.GetIndex(x, y);
+                }
+                // Moving vertically, stop wherever a horizontal jump would find something
+                if (Jump(x + 1, y, 1, 0) != -1 || Jump(x - 1, y, -1, 0) != -1) {
+                    return m_nodes.GetIndex(x, y);
+                }
+            }
+        }
+        else if (m_diagonalMovement == DIAGONAL_NO_CORNER_CUTTING) {
+            if (dx != 0 && dy != 0) {
+                if (Jump(x + dx, y, dx, 0) != -1 || Jump(x, y + dy, 0, dy) != -1) {
+                    return m_nodes.GetIndex(x, y);
+                }
+                if (!IsWalkable(x + dx, y) || !IsWalkable(x, y + dy)) {
+                    return -1;
+                }
+            }
+            else if (dx != 0) {
+                if ((IsWalkable(x, y - 1) && !IsWalkable(x - dx, y - 1)) || (IsWalkable(x, y + 1) && !IsWalkable(x - dx, y + 1))) {
+                    return m_nodes.GetIndex(x, y);
+                }
+            }
+            else {
+                if ((IsWalkable(x - 1, y) && !IsWalkable(x - 1, y - dy)) || (IsWalkable(x + 1, y) && !IsWalkable(x + 1, y - dy))) {
+                    return m_nodes.GetIndex(x, y);
+                }
+            }
+        }
+        else {
+            if (dx != 0 && dy != 0) {
+                if ((IsWalkable(x - dx, y + dy) && !IsWalkable(x - dx, y)) || (IsWalkable(x + dx, y - dy) && !IsWalkable(x, y - dy))) {
+                    return m_nodes.GetIndex(x, y);
+                }
+                if (Jump(x + dx, y, dx, 0) != -1 || Jump(x, y + dy, 0, dy) != -1) {
+                    return m_nodes.GetIndex(x, y);
+                }
+                if (!IsWalkable(x + dx, y) && !IsWalkable(x, y + dy)) {
+                    return -1;
+                }
+            }
+            else if (dx != 0) {
+                if ((IsWalkable(x + dx, y - 1) && !IsWalkable(x, y - 1)) || (IsWalkable(x + dx, y + 1) && !IsWalkable(x, y + 1))) {
+                    return m_nodes.GetIndex(x, y);
+                }
+            }
+            else {
+                if ((IsWalkable(x - 1, y + dy) && !IsWalkable(x - 1, y)) || (IsWalkable(x + 1, y + dy) && !IsWalkable(x + 1, y))) {
+                    return m_nodes.GetIndex(x, y);
+                }
+            }
+        }
+        x += dx;
+        y += dy;
+    }
+}
+
+// JPS+ version of FindJumpPoints. Each jump is a table lookup, plus a check for the destination being
+// on the line (or, for diagonal and vertical-only-without-diagonals scans, on a row or column the scan crosses).
+int AStar::FindJumpPointsFromTable(int index, int* jumpPoints) {
+    int x = m_nodes.GetX(index);
+    int y = m_nodes.GetY(index);
+    int destinationX = m_nodes.GetX(m_destination);
+    int destinationY = m_nodes.GetY(m_destination);
+    int neighbours[8];
+    int neighbourCount = FindPrunedNeighbours(index, neighbours);
+    int count = 0;
+    for (int i = 0; i < neighbourCount; i++) {
+        int dx = m_nodes.GetX(neighbours[i]) - x;
+        int dy = m_nodes.GetY(neighbours[i]) - y;
+        int distance = m_jumpDistances->GetDistance(x, y, JumpDistanceTable::GetDirection(dx, dy));
+        int reach = std::abs(distance);
+        int offsetX = destinationX - x;
+        int offsetY = destinationY - y;
+        int steps = -1;
+        if (dx != 0 && dy != 0) {
+            // Destination in this quadrant, stop where the scan reaches its row or column
+            if (glm::sign(offsetX) == dx && glm::sign(offsetY) == dy) {
+                int stepsToLine = std::min(std::abs(offsetX), std::abs(offsetY));
+                if (stepsToLine <= reach) {
+                    steps = stepsToLine;
+                }
+            }
+        }
+        else if (dx != 0) {
+            if (offsetY == 0 && glm::sign(offsetX) == dx && std::abs(offsetX) <= reach) {
+                steps = std::abs(offsetX);
+            }
+        }
+        else {
+            if (offsetX == 0 && glm::sign(offsetY) == dy && std::abs(offsetY) <= reach) {
+                steps = std::abs(offsetY);
+            }
+            // Without diagonals, a vertical scan also stops on the destination's row
+            else if (m_diagonalMovement == DIAGONAL_NEVER && glm::sign(offsetY) == dy && std::abs(offsetY) <= reach) {
+                steps = std::abs(offsetY);
+            }
+        }
+        if (steps == -1 && distance > 0) {
+            steps = distance;
+        }
+        if (steps > 0) {
+            jumpPoints[count++] = m_nodes.GetIndex(x + dx * steps, y + dy * steps);
+        }
+    }
+    return count;
+}
+
+int AStar::GetDistance(int indexA, int indexB) {
+    int dstX = std::abs(m_nodes.GetX(indexA) - m_nodes.GetX(indexB));
+    int dstY = std::abs(m_nodes.GetY(indexA) - m_nodes.GetY(indexB));
+    if (dstX > dstY) {
+        return DIAGONAL_COST * dstY + ORTHOGONAL_COST * (dstX - dstY);
+    }
+    else {
+        return DIAGONAL_COST * dstX + ORTHOGONAL_COST * (dstY - dstX);
+    }
+}
+
+// Cost of a single step between neighbouring cells, in either direction
+int AStar::GetStepCost(int indexA, int indexB) {
+    int cost = GetDistance(indexA, indexB);
+    return m_terrain ? m_terrain->GetStepCost(indexA, indexB, cost) : cost;
+}
+
+// Straight line cost in the same units as GetDistance
+int AStar::GetEuclideanDistance(int indexA, int indexB) {
+    return AnyAngleDistance::Get(m_nodes.GetX(indexA) - m_nodes.GetX(indexB), m_nodes.GetY(indexA) - m_nodes.GetY(indexB));
+}
+
+int AStar::GetH(int index) {
+    // Upward searches can't aim for the target, the hierarchy is what keeps them small
+    if (m_searchMode == SEARCH_MODE_CONTRACTION_HIERARCHY) {
+        return 0;
+    }
+    int h = 0;
+    if (m_searchMode == SEARCH_MODE_LAZY_THETA) {
+        h = GetH<AnyAngleDistance, false>(index);
+    }
+    else {
+        switch (m_heuristic) {
+            case HEURISTIC_MANHATTAN: h = GetH<ManhattanHeuristic, false>(index); break;
+            case HEURISTIC_EUCLIDEAN: h = GetH<EuclideanHeuristic, false>(index); break;
+            default: h = GetH<OctileHeuristic, false>(index); break;
+        }
+    }
+    if (m_landmarks) {
+        h = std::max(h, m_landmarks->GetLowerBound(index, m_destination));
+    }
     return h;
 }
 
+template <typename Heuristic, bool Landmarks>
+int AStar::GetH(int index) {
+    int h = Heuristic::Get(m_nodes.GetX(index) - m_nodes.GetX(m_destination), m_nodes.GetY(index) - m_nodes.GetY(m_destination)) * m_heuristicScale;
+    // Landmark bounds are consistent, so their max with a consistent heuristic is too
+    if constexpr (Landmarks) {
+        return std::max(h, m_landmarks->GetLowerBound(index, m_destination));
+    }
+    return h;
+}
+
+void NodeStore::Resize(int mapWidth, int mapHeight) {
+    width = mapWidth;
+    height = mapHeight;
+    g.resize(width * height);
+    f.resize(width * height);
+    parent.resize(width * height);
+    heapIndex.resize(width * height);
+    state.resize(width * height);
+    generation.assign(width * height, 0);
+    currentGeneration = 0;
+}
+
+void NodeStore::NewGeneration() {
+    currentGeneration++;
+    // Wrapped around, so old stamps could match again. Pay for one full reset.
+    if (currentGeneration == 0) {
+        std::fill(generation.begin(), generation.end(), 0);
+        currentGeneration = 1;
+    }
+}
+
+void NodeStore::Touch(int index) {
+    if (generation[index] != currentGeneration) {
+        generation[index] = currentGeneration;
+        g[index] = INT_MAX;
+        f[index] = -1;
+        parent[index] = -1;
+        heapIndex[index] = -1;
+        state[index] = NODE_UNVISITED;
+    }
+}
+
+int NodeStore::GetIndex(int x, int y) {
+    return y * width + x;
+}
+
+int NodeStore::GetX(int index) {
+    return index % width;
+}
+
+int NodeStore::GetY(int index) {
+    return index / width;
+}
+
+int NodeStore::Size() {
+    return width * height;
+}
+
 void MinHeap::AllocateSpace(int size) {
-    items = std::vector<Cell*>(size);
+    items = std::vector<int>(size);
 }
 
-void MinHeap::AddItem(Cell* item) {
-    item->heapIndex = currentItemCount;
+void MinHeap::AddItem(int item) {
+    nodes->heapIndex[item] = currentItemCount;
     items[currentItemCount] = item;
     SortUp(item);
     currentItemCount++;
 }
 
-void MinHeap::Update(Cell* cell) {
-    SortUp(cell);
+void MinHeap::Update(int item) {
+    SortUp(item);
 }
 
-bool MinHeap::Contains(Cell* cell) {
-    return (items[cell->heapIndex] == cell);
+bool MinHeap::Contains(int item) {
+    return nodes->state[item] == NODE_OPEN;
 }
 
 bool MinHeap::IsEmpty() {
@@ -521,51 +1800,51 @@ void MinHeap::Clear() {
     currentItemCount = 0;
 }
 
-void MinHeap::SortUp(Cell* item) {
-    int parentIndex = (item->heapIndex - 1) / 2;
+void MinHeap::SortUp(int item) {
+    int parentIndex = (nodes->heapIndex[item] - 1) / 2;
     while (true) {
-        Cell* parent = items[parentIndex];
-        if (parent->f > item->f) {
+        int parent = items[parentIndex];
+        if (nodes->f[parent] > nodes->f[item]) {
             Swap(item, parent);
         }
         else {
             break;
         }
-        parentIndex = (item->heapIndex - 1) / 2;
+        parentIndex = (nodes->heapIndex[item] - 1) / 2;
     }
 }
 
-void MinHeap::Swap(Cell* cellA, Cell* cellB) {
-    items[cellA->heapIndex] = cellB;
-    items[cellB->heapIndex] = cellA;
-    int itemAIndex = cellA->heapIndex;
-    cellA->heapIndex = cellB->heapIndex;
-    cellB->heapIndex = itemAIndex;
+void MinHeap::Swap(int itemA, int itemB) {
+    items[nodes->heapIndex[itemA]] = itemB;
+    items[nodes->heapIndex[itemB]] = itemA;
+    int itemAIndex = nodes->heapIndex[itemA];
+    nodes->heapIndex[itemA] = nodes->heapIndex[itemB];
+    nodes->heapIndex[itemB] = itemAIndex;
 }
 
-Cell* MinHeap::RemoveFirst() {
-    Cell* firstItem = items[0];
+int MinHeap::RemoveFirst() {
+    int firstItem = items[0];
     currentItemCount--;
     items[0] = items[currentItemCount];
-    items[0]->heapIndex = 0;
+    nodes->heapIndex[items[0]] = 0;
     SortDown(items[0]);
     return firstItem;
 }
 
-void MinHeap::SortDown(Cell* cell) {
+void MinHeap::SortDown(int item) {
     while (true) {
-        int childIndexLeft = cell->heapIndex * 2 + 1;
-        int childIndexRight = cell->heapIndex * 2 + 2;
+        int childIndexLeft = nodes->heapIndex[item] * 2 + 1;
+        int childIndexRight = nodes->heapIndex[item] * 2 + 2;
         int swapIndex = 0;
         if (childIndexLeft < currentItemCount) {
             swapIndex = childIndexLeft;
             if (childIndexRight < currentItemCount) {
-                if (items[childIndexLeft]->f > items[childIndexRight]->f) {
+                if (nodes->f[items[childIndexLeft]] > nodes->f[items[childIndexRight]]) {
                     swapIndex = childIndexRight;
                 }
             }
-            if (cell->f > items[swapIndex]->f)
-                Swap(cell, items[swapIndex]);
+            if (nodes->f[item] > nodes->f[items[swapIndex]])
+                Swap(item, items[swapIndex]);
             else {
                 return;
             }
@@ -574,4 +1853,265 @@ void MinHeap::SortDown(Cell* cell) {
             return;
         }
     }
+}
+
+void ObstacleGrid::Resize(int mapWidth, int mapHeight) {
+    width = mapWidth;
+    height = mapHeight;
+    wordsPerRow = (width + GRID_PADDING * 2 + 63) / 64;
+    words.resize(wordsPerRow * (height + GRID_PADDING * 2));
+    Clear();
+}
+
+void ObstacleGrid::Clear() {
+    int rowCount = height + GRID_PADDING * 2;
+    for (int row = 0; row < rowCount; row++) {
+        uint64_t* rowWords = &words[row * wordsPerRow];
+        bool isBorderRow = (row < GRID_PADDING || row >= height + GRID_PADDING);
+        for (int i = 0; i < wordsPerRow; i++) {
+            if (isBorderRow) {
+                rowWords[i] = ~0ull;
+                continue;
+            }
+            // Block the padding columns and any bits past the right edge
+            uint64_t word = 0;
+            for (int bit = 0; bit < 64; bit++) {
+                int x = i * 64 + bit - GRID_PADDING;
+                if (x < 0 || x >= width) {
+                    word |= 1ull << bit;
+                }
+            }
+            rowWords[i] = word;
+        }
+    }
+}
+
+void ObstacleGrid::Set(int x, int y, bool value) {
+    int bit = x + GRID_PADDING;
+    uint64_t& word = words[(y + GRID_PADDING) * wordsPerRow + (bit >> 6)];
+    if (value) {
+        word |= 1ull << (bit & 63);
+    }
+    else {
+        word &= ~(1ull << (bit & 63));
+    }
+}
+
+void TerrainCosts::Resize(int mapWidth, int mapHeight) {
+    width = mapWidth;
+    height = mapHeight;
+    Clear();
+}
+
+void TerrainCosts::Clear() {
+    weights.assign(width * height, 1);
+    std::fill(std::begin(weightCounts), std::end(weightCounts), 0);
+    weightCounts[1] = width * height;
+}
+
+// Weights are clamped to 1-255, a step never costs less than its base cost
+void TerrainCosts::Set(int x, int y, int weight) {
+    weight = std::clamp(weight, 1, 255);
+    uint8_t& cell = weights[y * width + x];
+    weightCounts[cell]--;
+    weightCounts[weight]++;
+    cell = (uint8_t)weight;
+}
+
+int TerrainCosts::GetMinWeight() const {
+    for (int weight = 1; weight < 256; weight++) {
+        if (weightCounts[weight] > 0) {
+            return weight;
+        }
+    }
+    return 1;
+}
+
+// Every cell is plain ground, so searches can skip the weights entirely
+bool TerrainCosts::IsUniform() const {
+    return weightCounts[1] == width * height;
+}
+
+// Points are in cell units, so a cell centre is x + 0.5. The segment is blocked by any wall whose interior
+// it crosses. A segment running along a grid line is only blocked if the cells on both sides are, and one
+// passing exactly through the corner of four cells follows cornerPolicy.
+bool ObstacleGrid::HasLineOfSight(float x0, float y0, float x1, float y1, CornerPolicy cornerPolicy) const {
+    if (std::min(x0, x1) < 0 || std::min(y0, y1) < 0 || std::max(x0, x1) > width || std::max(y0, y1) > height) {
+        return false;
+    }
+    // Shallow segments cross few rows, so testing each row's span a word at a time beats visiting cells
+    if (std::abs(x1 - x0) >= LOS_BITBOARD_MIN_SPAN * (std::abs(y1 - y0) + 1)) {
+        return SpanLineOfSight(x0, y0, x1, y1, cornerPolicy);
+    }
+    return TraceLineOfSight(x0, y0, x1, y1, cornerPolicy);
+}
+
+// Exact grid traversal (Amanatides & Woo), one cell at a time
+bool ObstacleGrid::TraceLineOfSight(float x0, float y0, float x1, float y1, CornerPolicy cornerPolicy) const {
+    float dx = x1 - x0;
+    float dy = y1 - y0;
+    int stepX = (dx > 0) - (dx < 0);
+    int stepY = (dy > 0) - (dy < 0);
+    int x = (int)std::floor(x0);
+    int y = (int)std::floor(y0);
+    int endX = (int)std::floor(x1);
+    int endY = (int)std::floor(y1);
+    if (stepX == 0 && stepY == 0) {
+        return !IsBlocked(x, y);
+    }
+    // A point on a grid line belongs to the cell the segment is heading into
+    if (stepX < 0 && x0 == (float)x) {
+        x--;
+    }
+    if (stepY < 0 && y0 == (float)y) {
+        y--;
+    }
+    if (stepX > 0 && x1 == (float)endX) {
+        endX--;
+    }
+    if (stepY > 0 && y1 == (float)endY) {
+        endY--;
+    }
+    if (stepX == 0 && x0 == std::floor(x0)) {
+        for (int lineX = (int)x0; ; y += stepY) {
+            if (IsBlocked(lineX - 1, y) && IsBlocked(lineX, y)) {
+                return false;
+            }
+            if (y == endY) {
+                return true;
+            }
+        }
+    }
+    if (stepY == 0 && y0 == std::floor(y0)) {
+        for (int lineY = (int)y0; ; x += stepX) {
+            if (IsBlocked(x, lineY - 1) && IsBlocked(x, lineY)) {
+                return false;
+            }
+            if (x == endX) {
+                return true;
+            }
+        }
+    }
+    const float epsilon = 1e-5f;
+    float tDeltaX = (stepX != 0) ? 1.0f / std::abs(dx) : INFINITY;
+    float tDeltaY = (stepY != 0) ? 1.0f / std::abs(dy) : INFINITY;
+    float tMaxX = (stepX > 0) ? (x + 1 - x0) * tDeltaX : (stepX < 0) ? (x0 - x) * tDeltaX : INFINITY;
+    float tMaxY = (stepY > 0) ? (y + 1 - y0) * tDeltaY : (stepY < 0) ? (y0 - y) * tDeltaY : INFINITY;
+    if (IsBlocked(x, y)) {
+        return false;
+    }
+    while (x != endX || y != endY) {
+        // Once one axis has reached its last cell float drift must not push it further
+        float difference = tMaxX - tMaxY;
+        if (y == endY || (x != endX && difference < -epsilon)) {
+            x += stepX;
+            tMaxX += tDeltaX;
+        }
+        else if (x == endX || difference > epsilon) {
+            y += stepY;
+            tMaxY += tDeltaY;
+        }
+        else {
+            bool blockedX = IsBlocked(x + stepX, y);
+            bool blockedY = IsBlocked(x, y + stepY);
+            if ((cornerPolicy == CORNER_POLICY_STRICT) ? (blockedX || blockedY) : (blockedX && blockedY)) {
+                return false;
+            }
+            x += stepX;
+            y += stepY;
+            tMaxX += tDeltaX;
+            tMaxY += tDeltaY;
+        }
+        if (IsBlocked(x, y)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Same rules as TraceLineOfSight, but walks row by row and tests the run of cells crossed in each row as
+// a bit mask. Only used for segments that are far from vertical, which always have dx != 0.
+bool ObstacleGrid::SpanLineOfSight(float x0, float y0, float x1, float y1, CornerPolicy cornerPolicy) const {
+    float dx = x1 - x0;
+    float dy = y1 - y0;
+    int stepX = (dx > 0) ? 1 : -1;
+    int stepY = (dy > 0) - (dy < 0);
+    int y = (int)std::floor(y0);
+    int endY = (int)std::floor(y1);
+    if (stepY < 0 && y0 == (float)y) {
+        y--;
+    }
+    if (stepY > 0 && y1 == (float)endY) {
+        endY--;
+    }
+    // Cells between entering and leaving a row, points on a grid line belong to the cell the segment heads into
+    auto getFirstCell = [stepX](float entryX) {
+        int cell = (int)std::floor(entryX);
+        return (stepX < 0 && entryX == (float)cell) ? cell - 1 : cell;
+    };
+    auto getLastCell = [stepX](float exitX) {
+        int cell = (int)std::floor(exitX);
+        return (stepX > 0 && exitX == (float)cell) ? cell - 1 : cell;
+    };
+    if (stepY == 0) {
+        int firstCell = getFirstCell(x0);
+        int lastCell = getLastCell(x1);
+        if (y0 == (float)y) {
+            return !IsEdgeSpanBlocked(std::min(firstCell, lastCell), std::max(firstCell, lastCell), y);
+        }
+        return !IsSpanBlocked(std::min(firstCell, lastCell), std::max(firstCell, lastCell), y);
+    }
+    float entryX = x0;
+    while (true) {
+        bool lastRow = (y == endY);
+        // Multiply before dividing so crossings that land on a grid line come out exact
+        float exitX = lastRow ? x1 : x0 + ((stepY > 0 ? y + 1 : y) - y0) * dx / dy;
+        int firstCell = getFirstCell(entryX);
+        int lastCell = getLastCell(exitX);
+        if (IsSpanBlocked(std::min(firstCell, lastCell), std::max(firstCell, lastCell), y)) {
+            return false;
+        }
+        if (lastRow) {
+            return true;
+        }
+        if (exitX == std::floor(exitX)) {
+            // Leaves the row through the exact corner of four cells
+            bool blockedX = IsBlocked(lastCell + stepX, y);
+            bool blockedY = IsBlocked(lastCell, y + stepY);
+            if ((cornerPolicy == CORNER_POLICY_STRICT) ? (blockedX || blockedY) : (blockedX && blockedY)) {
+                return false;
+            }
+        }
+        entryX = exitX;
+        y += stepY;
+    }
+}
+
+bool ObstacleGrid::IsSpanBlocked(int minX, int maxX, int y) const {
+    for (int x = minX; x <= maxX; x += 64) {
+        uint64_t bits = GetRowBits(x, y);
+        int count = maxX - x + 1;
+        if (count < 64) {
+            bits &= (1ull << count) - 1;
+        }
+        if (bits) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// For a segment lying on the grid line above row lineY, blocked where the cells on both sides are
+bool ObstacleGrid::IsEdgeSpanBlocked(int minX, int maxX, int lineY) const {
+    for (int x = minX; x <= maxX; x += 64) {
+        uint64_t bits = GetRowBits(x, lineY - 1) & GetRowBits(x, lineY);
+        int count = maxX - x + 1;
+        if (count < 64) {
+            bits &= (1ull << count) - 1;
+        }
+        if (bits) {
+            return true;
+        }
+    }
+    return false;
 }
\ No newline at end of file
@@ -1,13 +1,169 @@
 #pragma once
 #include <vector>
-#include <list>
+#include <cstdint>
+#include <climits>
 #include <glm/glm.hpp>
 
 #define CELL_SIZE 32
 #define ORTHOGONAL_COST 10
 #define DIAGONAL_COST 14
+#define GRID_PADDING 1
+#define LOS_BITBOARD_MIN_SPAN 4 // Average cells per row a segment must cover before line of sight tests whole row spans
+#define SEARCH_FRAME_BUDGET_US 2000 // Time an interactive search may take per frame before it carries on in the next one
+#define SEARCH_CLOCK_INTERVAL 16 // Expansions between clock reads when a step has a time budget
 
 struct AStar;
+struct ObstacleGrid;
+struct TerrainCosts;
+struct JumpDistanceTable;
+struct LandmarkTable;
+struct ConnectedComponents;
+struct HierarchicalPathfinder;
+struct HierarchicalPath;
+struct FlowField;
+struct DStarLite;
+struct AnytimeAStar;
+struct ContractionHierarchy;
+struct PathCacheStats;
+
+enum SearchMode { SEARCH_MODE_ASTAR = 0, SEARCH_MODE_JPS, SEARCH_MODE_JPS_PLUS, SEARCH_MODE_HPA, SEARCH_MODE_LAZY_THETA, SEARCH_MODE_BIDIRECTIONAL, SEARCH_MODE_DSTAR_LITE, SEARCH_MODE_ARA, SEARCH_MODE_CONTRACTION_HIERARCHY, SEARCH_MODE_COUNT };
+enum DiagonalMovement { DIAGONAL_NEVER = 0, DIAGONAL_NO_CORNER_CUTTING, DIAGONAL_CORNER_CUTTING, DIAGONAL_MOVEMENT_COUNT };
+enum SearchStatus { SEARCH_RUNNING = 0, SEARCH_FOUND, SEARCH_NO_PATH };
+enum HeuristicType { HEURISTIC_OCTILE = 0, HEURISTIC_MANHATTAN, HEURISTIC_EUCLIDEAN, HEURISTIC_TYPE_COUNT };
+enum OpenListType { OPEN_LIST_BINARY_HEAP = 0, OPEN_LIST_BUCKET_QUEUE, OPEN_LIST_QUATERNARY_HEAP, OPEN_LIST_TYPE_COUNT };
+
+// How line of sight treats a segment passing exactly through the corner shared by four cells
+enum CornerPolicy {
+    CORNER_POLICY_STRICT = 0,   // Both cells beside the corner must be open
+    CORNER_POLICY_LENIENT       // One open cell beside the corner is enough, only squeezing between two walls is blocked
+};
+
+// Read-only view of a loaded map. Any number of searches can share one.
+struct MapView {
+    const ObstacleGrid* grid = nullptr;
+    const JumpDistanceTable* jumpDistances = nullptr;  // Optional, JPS+ runs as JPS without a matching table
+    const LandmarkTable* landmarks = nullptr;          // Optional, tightens the heuristic when it matches the movement rules
+    const ConnectedComponents* components = nullptr;   // Optional, lets searches to another component fail straight away
+    const TerrainCosts* terrain = nullptr;             // Optional, every step costs its base cost without it
+    const ContractionHierarchy* contractionHierarchy = nullptr; // Optional, must be built from this grid and terrain. Its search mode runs as A* without one.
+};
+
+// Everything about how a search runs that isn't part of the map
+struct SearchConfig {
+    SearchMode searchMode = SEARCH_MODE_ASTAR;
+    DiagonalMovement diagonalMovement = DIAGONAL_NEVER;
+    OpenListType openList = OPEN_LIST_QUATERNARY_HEAP;
+    HeuristicType heuristic = HEURISTIC_OCTILE;  // Lazy Theta* always uses Euclidean and bidirectional A* always octile
+};
+
+struct PathRequest {
+    int startX = 0;
+    int startY = 0;
+    int targetX = 0;
+    int targetY = 0;
+};
+
+struct PathResult {
+    bool found = false;
+    int cost = 0;               // Same units as AStar g costs
+    int expandedNodes = 0;
+    std::vector<int> path;      // Cell indices excluding the start, same as AStar::GetPath. Lazy Theta* only gives the turning points.
+};
+
+inline CornerPolicy GetCornerPolicy(DiagonalMovement diagonalMovement) {
+    return (diagonalMovement == DIAGONAL_CORNER_CUTTING) ? CORNER_POLICY_LENIENT : CORNER_POLICY_STRICT;
+}
+
+// Row-major occupancy bitmap, one bit per cell packed into 64-bit words. The map is surrounded by
+// GRID_PADDING blocked cells (and every unused bit past the right edge is blocked too), so any cell
+// from -1 to width/height can be read without a bounds check.
+struct ObstacleGrid {
+    int width = 0;
+    int height = 0;
+    int wordsPerRow = 0;
+    std::vector<uint64_t> words;
+
+    void Resize(int mapWidth, int mapHeight);
+    void Clear();
+    void Set(int x, int y, bool value);
+    bool HasLineOfSight(float x0, float y0, float x1, float y1, CornerPolicy cornerPolicy) const;
+
+    const uint64_t* GetRow(int y) const {
+        return &words[(y + GRID_PADDING) * wordsPerRow];
+    }
+    uint64_t GetRowWord(int y, int wordIndex) const {
+        return GetRow(y)[wordIndex];
+    }
+    bool IsBlocked(int x, int y) const {
+        int bit = x + GRID_PADDING;
+        return (GetRow(y)[bit >> 6] >> (bit & 63)) & 1;
+    }
+    // 64 cells of row y starting at x, cell x in bit 0. Cells past the right edge read as blocked.
+    uint64_t GetRowBits(int x, int y) const {
+        const uint64_t* row = GetRow(y);
+        int bit = x + GRID_PADDING;
+        int wordIndex = bit >> 6;
+        int shift = bit & 63;
+        uint64_t bits = row[wordIndex] >> shift;
+        if (shift != 0) {
+            uint64_t next = (wordIndex + 1 < wordsPerRow) ? row[wordIndex + 1] : ~0ull;
+            bits |= next << (64 - shift);
+        }
+        return bits;
+    }
+    // Whether a single step from x, y by dx, dy is allowed. Diagonal steps follow the DiagonalMovement rules.
+    bool CanStep(int x, int y, int dx, int dy, DiagonalMovement diagonalMovement) const {
+        if (IsBlocked(x + dx, y + dy)) {
+            return false;
+        }
+        if (dx == 0 || dy == 0) {
+            return true;
+        }
+        bool blockedX = IsBlocked(x + dx, y);
+        bool blockedY = IsBlocked(x, y + dy);
+        if (diagonalMovement == DIAGONAL_NO_CORNER_CUTTING) {
+            return !blockedX && !blockedY;
+        }
+        else if (diagonalMovement == DIAGONAL_CORNER_CUTTING) {
+            return !blockedX || !blockedY;
+        }
+        return false;
+    }
+    // 3x3 block around x, y. Bits 0-2 are row y - 1, bits 3-5 row y and bits 6-8 row y + 1, west to east.
+    uint32_t GetNeighbourhood(int x, int y) const {
+        return (uint32_t)(GetRowBits(x - 1, y - 1) & 7) | (uint32_t)(GetRowBits(x - 1, y) & 7) << 3 | (uint32_t)(GetRowBits(x - 1, y + 1) & 7) << 6;
+    }
+
+private:
+    bool TraceLineOfSight(float x0, float y0, float x1, float y1, CornerPolicy cornerPolicy) const;
+    bool SpanLineOfSight(float x0, float y0, float x1, float y1, CornerPolicy cornerPolicy) const;
+    bool IsSpanBlocked(int minX, int maxX, int y) const;
+    bool IsEdgeSpanBlocked(int minX, int maxX, int lineY) const;
+};
+
+// Traversal weight per cell, 1 for plain ground and up to 255. A step costs its base cost times the mean
+// weight of the two cells it joins, so steps stay symmetric the way the backward searches, landmarks and
+// D* Lite need. Both base costs are even, so the mean never rounds. A count per weight keeps the minimum,
+// which scales the heuristics, current through edits.
+struct TerrainCosts {
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> weights;
+    int weightCounts[256] = {};
+
+    void Resize(int mapWidth, int mapHeight);
+    void Clear();
+    void Set(int x, int y, int weight);
+    int GetMinWeight() const;
+    bool IsUniform() const;
+
+    int Get(int x, int y) const {
+        return weights[y * width + x];
+    }
+    int GetStepCost(int indexA, int indexB, int baseCost) const {
+        return baseCost * (weights[indexA] + weights[indexB]) / 2;
+    }
+};
 
 namespace Pathfinding {
     void Init();
@@ -18,9 +174,11 @@ namespace Pathfinding {
     void SetStart(int x, int y);;
     void SetTarget(int x, int y);
     void SetObstacle(int x, int y, bool value);
+    void SetTerrainWeight(int x, int y, int weight);
     bool IsInBounds(int x, int y);
     bool IsObstacle(int x, int y);
     bool HasLineOfSight(float x0, float y0, float x1, float y1);
+    bool IsReachable(int startX, int startY, int targetX, int targetY);
     int GetMouseX();
     int GetMouseY();
     int GetMouseCellX();
@@ -32,67 +190,208 @@ namespace Pathfinding {
     int GetTargetX();
     int GetTargetY();
     bool SlowModeEnabled();
+    SearchMode GetSearchMode();
+    DiagonalMovement GetDiagonalMovement();
+    HeuristicType GetHeuristic();
     AStar& GetAStar();
+    const ObstacleGrid& GetObstacleGrid();
+    const TerrainCosts& GetTerrainCosts();
+    int GetTerrainBrushWeight();
+    const JumpDistanceTable& GetJumpDistanceTable();
+    MapView GetMapView();
+    bool LandmarksReady();
+    bool ContractionHierarchyReady();
+    SearchConfig GetSearchConfig();
+    const HierarchicalPathfinder& GetHierarchicalPathfinder();
+    const HierarchicalPath& GetHierarchicalPath();
+    const FlowField& GetFlowField();
+    const DStarLite& GetDStarLite();
+    const AnytimeAStar& GetAnytimeAStar();
+    void FindPaths(const std::vector<PathRequest>& requests, std::vector<PathResult>& results);
+    const PathCacheStats& GetPathCacheStats();
+    bool FlowFieldEnabled();
 }
 
-struct Cell {
-    int x, y;
-    bool obstacle;
-    int g = 99999;  // G cost: distance from starting node
-    int h = -1;     // H cost: distance from end node. Aka the heuristic.
-    int f = -1;     // F cost: g + f
-    std::vector<Cell*> neighbours;
-    Cell* parent = nullptr;
-    int heapIndex = -1;
-    float GetF(Cell* destination);
-    float GetH(Cell* destination);
+enum NodeState : uint8_t { NODE_UNVISITED = 0, NODE_OPEN, NODE_CLOSED, NODE_INCONSISTENT }; // Inconsistent: ARA* only, closed and cheaper since
+
+struct NodeStore {
+    int width = 0;
+    int height = 0;
+    std::vector<int> g;         // G cost: distance from starting node
+    std::vector<int> f;         // F cost: g + h
+    std::vector<int> parent;    // Index of the node we arrived from, -1 if none
+    std::vector<int> heapIndex; // Position in the open list heap
+    std::vector<uint8_t> state; // NodeState, replaces scanning the closed list
+    std::vector<uint32_t> generation; // Search that last wrote this node, anything else is stale
+    uint32_t currentGeneration = 0;
+    void Resize(int mapWidth, int mapHeight);
+    void NewGeneration();
+    void Touch(int index);
+    int GetIndex(int x, int y);
+    int GetX(int index);
+    int GetY(int index);
+    int Size();
 };
 
 struct MinHeap {
-    std::vector<Cell*> items;
+    std::vector<int> items;
+    NodeStore* nodes = nullptr;
+    int currentItemCount = 0;
+    void AllocateSpace(int size);
+    void AddItem(int item);
+    void Update(int item);
+    bool Contains(int item);
+    bool IsEmpty();
+    int Size();
+    void Clear();
+    void SortUp(int item);
+    void Swap(int itemA, int itemB);
+    int RemoveFirst();
+    void SortDown(int item);
+};
+
+// Open list for integer f values with one bucket per value, each a doubly linked list threaded through
+// per-node arrays. Insert, decrease-key and removal are O(1), and popping only scans forward over empty
+// buckets. Inserting below the current minimum just moves the scan back, so inconsistent heuristics still
+// work. A node's bucket is kept in NodeStore::heapIndex, which no heap is using meanwhile.
+struct BucketQueue {
+    std::vector<int> heads;     // First node of each f value, -1 if empty. Grows to the largest f seen.
+    std::vector<int> next;      // Per node
+    std::vector<int> previous;  // Per node
+    NodeStore* nodes = nullptr;
     int currentItemCount = 0;
+    int minBucket = 0;          // No bucket below this holds anything
     void AllocateSpace(int size);
-    void AddItem(Cell* item);
-    void Update(Cell* cell);
-    bool Contains(Cell* cell);
+    void AddItem(int item);
+    void Update(int item);
     bool IsEmpty();
     int Size();
     void Clear();
-    void SortUp(Cell* item);
-    void Swap(Cell* cellA, Cell* cellB);
-    Cell* RemoveFirst();
-    void SortDown(Cell* cell);
+    int PeekFirst();
+    int RemoveFirst();
+    void GetItems(std::vector<int>& items);
+    void Unlink(int item);
+};
+
+// Min-heap with four children per node. Entries carry their own key, so sifting compares neighbouring
+// entries instead of looking up f for every node it passes, and all four children of a node are read
+// together. Positions are kept in NodeStore::heapIndex for decrease-key. Equal f goes to the larger g,
+// the node closer to the target.
+struct QuaternaryHeap {
+    struct Entry {
+        uint64_t key;   // f in the high half, inverted g in the low half
+        int item;
+    };
+    std::vector<Entry> entries;
+    NodeStore* nodes = nullptr;
+    int currentItemCount = 0;
+    void AllocateSpace(int size);
+    void AddItem(int item);
+    void Update(int item);
+    bool IsEmpty();
+    int Size();
+    void Clear();
+    int PeekFirst();
+    int RemoveFirst();
+    void GetItems(std::vector<int>& items);
+    uint64_t GetKey(int item);
+    void SortUp(int position, Entry entry);
+    void SortDown(int position, Entry entry);
+};
+
+// The open list AStar and HPA* use, backed by whichever queue the search config picked
+struct OpenList {
+    OpenListType type = OPEN_LIST_QUATERNARY_HEAP;
+    MinHeap heap;
+    BucketQueue buckets;
+    QuaternaryHeap quaternaryHeap;
+    void Init(NodeStore* nodes, OpenListType type);
+    void AddItem(int item);
+    void Update(int item);
+    bool IsEmpty();
+    int Size();
+    void Clear();
+    int PeekFirst();
+    int RemoveFirst();
+    void GetItems(std::vector<int>& items);
 };
 
 struct AStar {
-    void InitSearch(std::vector<std::vector<bool>>& map, int startX, int startY, int destinationX, int destinationY);
+    void InitSearch(const MapView& map, const SearchConfig& config, int startX, int startY, int destinationX, int destinationY);
+    void InitBoundedSearch(const MapView& map, const SearchConfig& config, int startX, int startY, int destinationX, int destinationY, glm::ivec4 bounds);
+    void SetFinalPath(const std::vector<int>& path);
+    SearchStatus Step(int maxExpansions, int maxMicroseconds = 0);
+    SearchStatus GetStatus();
     void FindPath();
-    void FindSmoothPath();
+    void FindSmoothPath(int maxSteps = INT_MAX);
     void ClearData();
     bool GridPathFound();
     bool SmoothPathFound();
     bool SearchInitilized();
-    std::list<Cell*>& GetClosedList();
-    std::vector<Cell*>& GetPath();
-    MinHeap& GetOpenList();
-
-    Cell* m_start;
-    Cell* m_destination;
-    Cell* m_current;
-    MinHeap m_openList;
-    std::vector<std::vector<Cell>> m_cells;
-    std::list<Cell*> m_closedList;
-    std::vector<Cell*> m_finalPath;
+    bool SearchExhausted();
+    int GetPathCost();
+    std::vector<int>& GetClosedList();
+    std::vector<int>& GetPath();
+    OpenList& GetOpenList();
+    OpenList& GetBackwardOpenList();
+    NodeStore& GetNodes();
+    int GetForwardExpansions();
+    int GetBackwardExpansions();
+
+    const ObstacleGrid* m_map = nullptr;
+    const JumpDistanceTable* m_jumpDistances = nullptr;
+    const LandmarkTable* m_landmarks = nullptr;
+    const TerrainCosts* m_terrain = nullptr;
+    const ContractionHierarchy* m_contractionHierarchy = nullptr;
+    int m_start = -1;
+    int m_destination = -1;
+    int m_current = -1;
+    OpenList m_openList;
+    NodeStore m_nodes;
+    std::vector<int> m_closedList; // Expansion order, kept for the debug overlay
+    std::vector<int> m_finalPath;
     std::vector<glm::vec2> m_intersectionPoints;
+    OpenList m_backwardOpenList;  // Bidirectional and contraction hierarchy searches only, grows from the destination
+    NodeStore m_backwardNodes;
 
 private:
-    bool IsDestination(Cell* cell);
+    bool IsDestination(int index);
     void BuildFinalPath();
-    void AddIfUnique(std::list<Cell*>* list, Cell* cell);
-    bool IsOrthogonal(Cell* cellA, Cell* cellB);
-    bool IsInClosedList(Cell* cell);
-    void FindNeighbours(Cell* cell);
+    void InitSmoothPath();
+    bool IsInClosedList(int index);
+    bool IsWalkable(int x, int y);
+    int FindNeighbours(int index, int* neighbours);
+    template <typename Connectivity> int FindNeighbours(int index, int* neighbours);
+    int ClipToBounds(int* neighbours, int count);
+    int FindPrunedNeighbours(int index, int* neighbours);
+    int FindJumpPoints(int index, int* jumpPoints);
+    int Jump(int x, int y, int dx, int dy);
+    int FindJumpPointsFromTable(int index, int* jumpPoints);
+    using ExpandFunction = bool (AStar::*)();
+    bool Expand();
+    template <typename Connectivity, typename Heuristic, typename Features> bool ExpandKernel();
+    template <typename Connectivity, typename Heuristic> ExpandFunction SelectKernel() const;
+    bool ExpandBidirectional();
+    bool ExpandContractionHierarchy();
+    void SelectExpandFunction();
+    void SetVertex(int index);
+    int GetDistance(int indexA, int indexB);
+    int GetStepCost(int indexA, int indexB);
+    int GetEuclideanDistance(int indexA, int indexB);
+    int GetH(int index);
+    template <typename Heuristic, bool Landmarks> int GetH(int index);
 
+    ExpandFunction m_expand = nullptr;  // Picked once per search from the mode, movement rules, heuristic and extras
+    SearchMode m_searchMode = SEARCH_MODE_ASTAR;
+    DiagonalMovement m_diagonalMovement = DIAGONAL_NEVER;
+    HeuristicType m_heuristic = HEURISTIC_OCTILE;
+    int m_heuristicScale = 1;         // Cheapest terrain weight, no step costs less than its base cost times this
+    glm::ivec4 m_bounds = glm::ivec4(0); // minX, minY, maxX, maxY, inclusive
+    bool m_bounded = false;
+    int m_meetingNode = -1;           // Best node seen from both directions so far
+    int m_meetingCost = INT_MAX;      // Cost of the best path through it
+    int m_forwardExpansions = 0;
+    int m_backwardExpansions = 0;
     int m_smoothSearchIndex = 0;
     bool m_gridPathFound = false;
     bool m_smoothPathFound = false;
@@ -0,0 +1,67 @@
+#pragma once
+#include "Pathfinding.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+// Compile-time versions of the movement rules and heuristics, so AStar can build one expansion kernel
+// per combination with the choices folded away instead of branching on them for every neighbour.
+
+struct FourConnected {
+    static constexpr bool diagonal = false;
+    static constexpr bool CanMoveDiagonally(bool, bool) { return false; }
+};
+
+struct NoCornerCutting {
+    static constexpr bool diagonal = true;
+    static constexpr bool CanMoveDiagonally(bool sideABlocked, bool sideBBlocked) { return !sideABlocked && !sideBBlocked; }
+};
+
+// Cutting past one corner is fine, squeezing between two diagonal walls is not
+struct CornerCutting {
+    static constexpr bool diagonal = true;
+    static constexpr bool CanMoveDiagonally(bool sideABlocked, bool sideBBlocked) { return !sideABlocked || !sideBBlocked; }
+};
+
+// Exact cost on an open grid with diagonal steps
+struct OctileHeuristic {
+    static int Get(int dstX, int dstY) {
+        dstX = std::abs(dstX);
+        dstY = std::abs(dstY);
+        return DIAGONAL_COST * std::min(dstX, dstY) + ORTHOGONAL_COST * std::abs(dstX - dstY);
+    }
+};
+
+// Exact on an open grid without diagonals. Overestimates once diagonal steps are allowed, which trades
+// path length for fewer expansions.
+struct ManhattanHeuristic {
+    static int Get(int dstX, int dstY) {
+        return ORTHOGONAL_COST * (std::abs(dstX) + std::abs(dstY));
+    }
+};
+
+// Straight line distance, weaker than octile on a grid. A diagonal step costs less than ORTHOGONAL_COST
+// times root two, so the distance is scaled to what a diagonal step costs and rounded down to stay below
+// octile in every direction.
+struct EuclideanHeuristic {
+    static int Get(int dstX, int dstY) {
+        return (int)std::floor(DIAGONAL_COST * std::sqrt((dstX * dstX + dstY * dstY) / 2.0));
+    }
+};
+
+// Straight line distance rounded to the nearest unit, for paths that aren't tied to grid steps. Lazy Theta*
+// uses it for its g costs and its heuristic alike.
+struct AnyAngleDistance {
+    static int Get(int dstX, int dstY) {
+        return (int)std::round(ORTHOGONAL_COST * std::sqrt((double)(dstX * dstX + dstY * dstY)));
+    }
+};
+
+// Extras a search can switch on. They stay the same for the whole search, so the kernels are built with
+// and without each of them instead of checking every neighbour for them.
+template <bool Terrain, bool Landmarks, bool Bounded>
+struct SearchFeatures {
+    static constexpr bool terrain = Terrain;
+    static constexpr bool landmarks = Landmarks;
+    static constexpr bool bounded = Bounded;
+};
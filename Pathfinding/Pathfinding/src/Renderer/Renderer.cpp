@@ -4,6 +4,10 @@
 #include "../API/OpenGL/GL_renderer.h"
 #include "../BackEnd/BackEnd.h"
 #include "../Core/Game.h"
+#include "../Core/AnytimeAStar.h"
+#include "../Core/DStarLite.h"
+#include "../Core/FlowField.h"
+#include "../Core/HierarchicalPathfinding.h"
 #include "../Core/Input.h"
 #include "../Core/Pathfinding.h"
 #include "../Renderer/RenderData.h"
@@ -81,32 +85,122 @@ std::vector<RenderItem2D> CreateRenderItems2D(ivec2 presentSize) {
     else {
         text += "Slowmode: Off\n";
     }
+    text += "Search: " + Util::SearchModeToString(Pathfinding::GetSearchMode()) + "\n";
+    text += "Diagonals: " + Util::DiagonalMovementToString(Pathfinding::GetDiagonalMovement()) + "\n";
+    text += "Heuristic: " + Util::HeuristicTypeToString(Pathfinding::GetHeuristic()) + "\n";
+    text += "Open list: " + Util::OpenListTypeToString(Pathfinding::GetSearchConfig().openList) + "\n";
+    int brushWeight = Pathfinding::GetTerrainBrushWeight();
+    text += "Brush: " + ((brushWeight == 0) ? std::string("Wall") : "Terrain x" + std::to_string(brushWeight)) + "\n";
+    if (Pathfinding::IsInBounds(cellX, cellY)) {
+        text += "Terrain weight: " + std::to_string(Pathfinding::GetTerrainCosts().Get(cellX, cellY)) + "\n";
+    }
+    text += std::string("Landmarks: ") + (Pathfinding::LandmarksReady() ? "Ready" : "Building") + "\n";
+    if (Pathfinding::GetSearchMode() == SEARCH_MODE_CONTRACTION_HIERARCHY) {
+        text += std::string("Hierarchy: ") + (Pathfinding::ContractionHierarchyReady() ? "Ready" : "Out of date, save to rebuild") + "\n";
+    }
+    if (Pathfinding::GetSearchMode() == SEARCH_MODE_BIDIRECTIONAL || Pathfinding::GetSearchMode() == SEARCH_MODE_CONTRACTION_HIERARCHY) {
+        text += "Expanded: " + std::to_string(Pathfinding::GetAStar().GetForwardExpansions()) + " + " + std::to_string(Pathfinding::GetAStar().GetBackwardExpansions()) + "\n";
+    }
+    else if (Pathfinding::GetSearchMode() == SEARCH_MODE_DSTAR_LITE) {
+        text += "Expanded: " + std::to_string(Pathfinding::GetDStarLite().GetExpansions()) + "\n";
+    }
+    else if (Pathfinding::GetSearchMode() == SEARCH_MODE_ARA) {
+        const AnytimeAStar& ara = Pathfinding::GetAnytimeAStar();
+        text += "Expanded: " + std::to_string(ara.GetExpansions()) + "\n";
+        text += "Epsilon: " + std::format("{:.1f}", ara.GetEpsilon()) + "\n";
+        if (ara.PathFound()) {
+            text += "Cost: " + std::to_string(ara.GetPathCost()) + ", at most " + std::format("{:.2f}", ara.GetSuboptimalityBound()) + "x optimal\n";
+        }
+    }
+    else {
+        text += "Expanded: " + std::to_string(Pathfinding::GetAStar().GetForwardExpansions()) + "\n";
+    }
+    if (Pathfinding::FlowFieldEnabled()) {
+        int distance = Pathfinding::GetFlowField().GetDistance(Pathfinding::GetMouseCellX(), Pathfinding::GetMouseCellY());
+        text += "Flow distance: " + ((distance == FLOW_FIELD_UNREACHABLE) ? std::string("None") : std::to_string(distance)) + "\n";
+    }
+
+    const ObstacleGrid& obstacleGrid = Pathfinding::GetObstacleGrid();
+    for (int y = 0; y < obstacleGrid.height; y++) {
+        for (int wordX = 0; wordX < obstacleGrid.width; wordX += 64) {
+            uint64_t rowBits = obstacleGrid.GetRowBits(wordX, y);
+            int count = std::min(64, obstacleGrid.width - wordX);
+            for (int i = 0; i < count; i++) {
+                int x = wordX + i;
+                ivec2 drawLocation = ivec2(x * CELL_SIZE, PRESENT_HEIGHT - y * CELL_SIZE);
+
+                if ((rowBits >> i) & 1) {
+                    renderItems.push_back(RendererUtil::CreateRenderItem2D("tile_wall", drawLocation, viewportSize, TOP_LEFT));
+                }
+                else {
+                    renderItems.push_back(RendererUtil::CreateRenderItem2D("tile_dirt", drawLocation, viewportSize, TOP_LEFT));
+                }
+            }
+        }
+    }
 
-    for (int x = 0; x < Pathfinding::GetMapWidth(); x++) {
-        for (int y = 0; y < Pathfinding::GetMapHeight(); y++) {
-            ivec2 drawLocation = ivec2(x * CELL_SIZE, PRESENT_HEIGHT - y * CELL_SIZE);
+    // Heavier terrain shades from orange towards dark brown
+    const TerrainCosts& terrain = Pathfinding::GetTerrainCosts();
+    if (!terrain.IsUniform()) {
+        for (int y = 0; y < terrain.height; y++) {
+            for (int x = 0; x < terrain.width; x++) {
+                int weight = terrain.Get(x, y);
+                if (weight > 1 && !obstacleGrid.IsBlocked(x, y)) {
+                    float t = std::min(1.0f, std::log2((float)weight) / 4.0f);
+                    renderItems.push_back(CreateColoredTile(x, y, glm::mix(glm::vec3(0.9f, 0.6f, 0.2f), glm::vec3(0.3f, 0.18f, 0.05f), t)));
+                }
+            }
+        }
+    }
 
-            if (Pathfinding::IsObstacle(x, y)) {
-                renderItems.push_back(RendererUtil::CreateRenderItem2D("tile_wall", drawLocation, viewportSize, TOP_LEFT));
+    if (Pathfinding::FlowFieldEnabled()) {
+        // Shade reachable cells from light near the target to dark far away
+        const FlowField& flowField = Pathfinding::GetFlowField();
+        int maxDistance = 1;
+        for (int distance : flowField.distances) {
+            if (distance != FLOW_FIELD_UNREACHABLE) {
+                maxDistance = std::max(maxDistance, distance);
             }
-            else {
-                renderItems.push_back(RendererUtil::CreateRenderItem2D("tile_dirt", drawLocation, viewportSize, TOP_LEFT));
+        }
+        for (int y = 0; y < flowField.height; y++) {
+            for (int x = 0; x < flowField.width; x++) {
+                int distance = flowField.GetDistance(x, y);
+                if (distance != FLOW_FIELD_UNREACHABLE) {
+                    renderItems.push_back(CreateColoredTile(x, y, glm::mix(YELLOW, BLUE, (float)distance / maxDistance)));
+                }
             }
         }
     }
 
-    AStar aStar = Pathfinding::GetAStar();
+    AStar& aStar = Pathfinding::GetAStar();
+    NodeStore& nodes = aStar.GetNodes();
 
-    for (auto& cell : aStar.GetClosedList()) {
-        renderItems.push_back(CreateColoredTile(cell->x, cell->y, RED));
+    for (int index : aStar.GetClosedList()) {
+        renderItems.push_back(CreateColoredTile(nodes.GetX(index), nodes.GetY(index), RED));
     }
 
-    for (int i = 0; i < aStar.GetOpenList().Size(); i++) {
-        auto& cell = aStar.GetOpenList().items[i];
-        renderItems.push_back(CreateColoredTile(cell->x, cell->y, GREEN));
+    std::vector<int> openItems;
+    aStar.GetOpenList().GetItems(openItems);
+    for (int index : openItems) {
+        renderItems.push_back(CreateColoredTile(nodes.GetX(index), nodes.GetY(index), GREEN));
     }
-    for (auto& cell : aStar.GetPath()) {
-        renderItems.push_back(CreateColoredTile(cell->x, cell->y, BLUE));
+    aStar.GetBackwardOpenList().GetItems(openItems);
+    for (int index : openItems) {
+        renderItems.push_back(CreateColoredTile(nodes.GetX(index), nodes.GetY(index), GREEN));
+    }
+    for (int index : aStar.GetPath()) {
+        renderItems.push_back(CreateColoredTile(nodes.GetX(index), nodes.GetY(index), BLUE));
+    }
+    if (Pathfinding::GetSearchMode() == SEARCH_MODE_HPA) {
+        const HierarchicalPath& hierarchicalPath = Pathfinding::GetHierarchicalPath();
+        if (!aStar.GridPathFound()) {
+            for (int index : hierarchicalPath.cells) {
+                renderItems.push_back(CreateColoredTile(index % Pathfinding::GetMapWidth(), index / Pathfinding::GetMapWidth(), BLUE));
+            }
+        }
+        for (const glm::ivec2& waypoint : hierarchicalPath.waypoints) {
+            renderItems.push_back(CreateColoredTile(waypoint.x, waypoint.y, YELLOW));
+        }
     }
 
     renderItems.push_back(CreateColoredTile(Pathfinding::GetStartX(), Pathfinding::GetStartY(), glm::vec3(0.164f, 0.605f, 0.765f)));
@@ -125,7 +219,7 @@ void UpdateDebugLinesMesh() {
     std::vector<Vertex> vertices;
     std::vector<uint32_t> indices;
 
-    AStar aStar = Pathfinding::GetAStar();
+    AStar& aStar = Pathfinding::GetAStar();
 
     if (aStar.m_intersectionPoints.size() >= 2) {
         for (int i = 0; i < aStar.m_intersectionPoints.size() - 1; i++) {
@@ -136,6 +230,23 @@ void UpdateDebugLinesMesh() {
         }
     }
 
+    if (Pathfinding::FlowFieldEnabled()) {
+        // Short line from each cell centre towards the next step
+        const FlowField& flowField = Pathfinding::GetFlowField();
+        for (int y = 0; y < flowField.height; y++) {
+            for (int x = 0; x < flowField.width; x++) {
+                glm::ivec2 direction = flowField.GetDirection(x, y);
+                if (direction == glm::ivec2(0, 0)) {
+                    continue;
+                }
+                glm::vec2 cell0 = glm::vec2(x + 0.5f, y + 0.5f);
+                glm::vec2 cell1 = cell0 + glm::vec2(direction) * 0.4f;
+                vertices.push_back(Vertex(Util::ScreenToNDC(glm::vec2(cell0.x * CELL_SIZE, cell0.y * CELL_SIZE), glm::vec2(PRESENT_WIDTH, PRESENT_HEIGHT)), BLACK));
+                vertices.push_back(Vertex(Util::ScreenToNDC(glm::vec2(cell1.x * CELL_SIZE, cell1.y * CELL_SIZE), glm::vec2(PRESENT_WIDTH, PRESENT_HEIGHT)), BLACK));
+            }
+        }
+    }
+
     for (int i = 0; i < vertices.size(); i++) {
         indices.push_back(i);
     }
@@ -147,7 +258,7 @@ void UpdateDebugPointsMesh() {
     std::vector<Vertex> vertices;
     std::vector<uint32_t> indices;
 
-    AStar aStar = Pathfinding::GetAStar();
+    AStar& aStar = Pathfinding::GetAStar();
     for (int i = 0; i < aStar.m_intersectionPoints.size(); i++) {
         glm::vec2 cell0 = aStar.m_intersectionPoints[i];
         vertices.push_back(Vertex(Util::ScreenToNDC(glm::vec2(cell0.x * CELL_SIZE, cell0.y * CELL_SIZE), glm::vec2(PRESENT_WIDTH, PRESENT_HEIGHT)), WHITE));
@@ -11,6 +11,7 @@
 #include <format>
 #include <filesystem>
 #include "Renderer/RendererCommon.h"
+#include "Core/Pathfinding.h"
 
 namespace Util {
 
@@ -202,6 +203,84 @@ namespace Util {
         }
     }
 
+    inline std::string SearchModeToString(SearchMode mode) {
+        if (mode == SEARCH_MODE_ASTAR) {
+            return "A*";
+        }
+        else if (mode == SEARCH_MODE_JPS) {
+            return "JPS";
+        }
+        else if (mode == SEARCH_MODE_JPS_PLUS) {
+            return "JPS+";
+        }
+        else if (mode == SEARCH_MODE_HPA) {
+            return "HPA*";
+        }
+        else if (mode == SEARCH_MODE_LAZY_THETA) {
+            return "Lazy Theta*";
+        }
+        else if (mode == SEARCH_MODE_BIDIRECTIONAL) {
+            return "Bidirectional A*";
+        }
+        else if (mode == SEARCH_MODE_DSTAR_LITE) {
+            return "D* Lite";
+        }
+        else if (mode == SEARCH_MODE_ARA) {
+            return "ARA*";
+        }
+        else if (mode == SEARCH_MODE_CONTRACTION_HIERARCHY) {
+            return "Contraction hierarchy";
+        }
+        else {
+            return "UNDEFINED";
+        }
+    }
+
+    inline std::string DiagonalMovementToString(DiagonalMovement diagonalMovement) {
+        if (diagonalMovement == DIAGONAL_NEVER) {
+            return "Off";
+        }
+        else if (diagonalMovement == DIAGONAL_NO_CORNER_CUTTING) {
+            return "No corner cutting";
+        }
+        else if (diagonalMovement == DIAGONAL_CORNER_CUTTING) {
+            return "Corner cutting";
+        }
+        else {
+            return "UNDEFINED";
+        }
+    }
+
+    inline std::string HeuristicTypeToString(HeuristicType type) {
+        if (type == HEURISTIC_OCTILE) {
+            return "Octile";
+        }
+        else if (type == HEURISTIC_MANHATTAN) {
+            return "Manhattan";
+        }
+        else if (type == HEURISTIC_EUCLIDEAN) {
+            return "Euclidean";
+        }
+        else {
+            return "UNDEFINED";
+        }
+    }
+
+    inline std::string OpenListTypeToString(OpenListType type) {
+        if (type == OPEN_LIST_BINARY_HEAP) {
+            return "Binary heap";
+        }
+        else if (type == OPEN_LIST_BUCKET_QUEUE) {
+            return "Bucket queue";
+        }
+        else if (type == OPEN_LIST_QUATERNARY_HEAP) {
+            return "4-ary heap";
+        }
+        else {
+            return "UNDEFINED";
+        }
+    }
+
     inline std::string SplitscreenModeToString(SplitscreenMode mode) {
         if (mode == SplitscreenMode::NONE) {
             return "NONE";